@@ -3,12 +3,18 @@
 Based on https://github.com/inkstitch/inkstitch/blob/main/lib/stitches/auto_fill.py
 """
 
+import math
+import time
 from collections import deque
+from concurrent.futures import ProcessPoolExecutor
+from dataclasses import dataclass
 from itertools import pairwise  # type: ignore
-from itertools import groupby
-from typing import Any, Deque, Dict, Iterable, List, Tuple
+from typing import Any, Deque, Dict, Iterable, List, Optional, Tuple
 
 import networkx
+import numpy as np
+import shapely
+from scipy.spatial.distance import cdist
 from shapely import geometry as geo
 
 Point = Tuple[float, float]
@@ -23,21 +29,55 @@ def outlines(shape: geo.Polygon) -> List[geo.LineString]:
     return [outlines]  # only other option is a single LineString
 
 
-def sorted_grouped_by_outline(graph: networkx.MultiGraph) -> Dict[int, List[Any]]:
-    nodes = list(graph.nodes(data=True))
+def assign_to_outlines(
+    shape_outlines: List[geo.LineString],
+    nodes: List[Point],
+) -> Tuple[np.ndarray, np.ndarray]:
+    """Find the closest outline to each node, and the node's position along it.
 
-    def sort_key(node_and_data):
-        _, data = node_and_data
-        return (data["outline"], data["order"])
+    Returns a pair of arrays aligned with `nodes`: the index of the closest
+    outline, and the distance along that outline from its start to the
+    closest point on the outline to the node (as in `LineString.project`).
+    """
+    points = shapely.points(np.array(nodes, dtype=float))
 
-    def grouping_key(node_and_data):
-        _, data = node_and_data
-        return data["outline"]
+    # Index the individual line segments of each outline rather than whole
+    # outlines. The outer boundary's bounding box contains every node, so an
+    # index over whole outlines would prune almost nothing. The distance to an
+    # outline is the minimum distance to one of its line segments.
+    pieces, owners = [], []
+    for index, outline in enumerate(shape_outlines):
+        coords = shapely.get_coordinates(outline)
+        pieces.append(shapely.linestrings(np.stack([coords[:-1], coords[1:]], axis=1)))
+        owners.append(np.full(len(coords) - 1, index))
+    tree = shapely.STRtree(np.concatenate(pieces))
+    owner = np.concatenate(owners)
 
-    nodes.sort(key=sort_key)
+    # Equidistant segments are all reported, so keep the smallest outline
+    # index among them for each point.
+    point_indices, piece_indices = tree.query_nearest(points)
+    closest = np.full(len(nodes), len(shape_outlines))
+    np.minimum.at(closest, point_indices, owner[piece_indices])
+
+    orders = np.empty(len(nodes))
+    for index, outline in enumerate(shape_outlines):
+        on_outline = closest == index
+        orders[on_outline] = shapely.line_locate_point(outline, points[on_outline])
+    return closest, orders
+
+
+def sorted_grouped_by_outline(
+    nodes: List[Point],
+    outline_indices: np.ndarray,
+    orders: np.ndarray,
+) -> Dict[int, List[Any]]:
+    # lexsort is stable and sorts by the last key first
+    permutation = np.lexsort((orders, outline_indices))
+    sorted_outlines = outline_indices[permutation]
+    group_starts = np.flatnonzero(np.diff(sorted_outlines)) + 1
     return {
-        outline_index: [node for node, _ in nodes]
-        for outline_index, nodes in groupby(nodes, key=grouping_key)
+        int(outline_indices[group[0]]): [nodes[i] for i in group]
+        for group in np.split(permutation, group_starts)
     }
 
 
@@ -45,23 +85,145 @@ def pairwise_cyclic(itr):
     return list(pairwise(itr)) + [(itr[-1], itr[0])]
 
 
-def pick_edge(edges, segment_edges):
+class SegmentIndex:
+    """A spatial index over the grating segments that have not yet been traversed.
+
+    The underlying STRtree is static, so removed segments are masked out rather
+    than deleted, and nearest-segment queries search a growing box around the
+    query geometry until they find a remaining segment.
+    """
+
+    def __init__(self, segments: Iterable[GratingSegment]):
+        self.index_of: Dict[Edge, int] = dict()
+        lines: List[geo.LineString] = []
+        for source, target in segments:
+            if (source, target) in self.index_of:
+                continue
+            self.index_of[(source, target)] = len(lines)
+            self.index_of[(target, source)] = len(lines)
+            lines.append(geo.LineString([source, target]))
+
+        self.lines = np.array(lines, dtype=object)
+        self.tree = shapely.STRtree(self.lines)
+        self.remaining = np.ones(len(lines), dtype=bool)
+        self.remaining_count = len(lines)
+
+    def __len__(self) -> int:
+        return self.remaining_count
+
+    def remove(self, source: Point, target: Point) -> None:
+        index = self.index_of[(source, target)]
+        if self.remaining[index]:
+            self.remaining[index] = False
+            self.remaining_count -= 1
+
+    def distance_to_closest(self, line: geo.LineString) -> float:
+        """Return the distance from `line` to the closest remaining segment.
+
+        Any segment within distance `radius` of `line` has a bounding box that
+        intersects the bounding box of `line` grown by `radius`, so the minimum
+        over the query candidates is exact once it is at most `radius`.
+        """
+        minx, miny, maxx, maxy = line.bounds
+        radius = 0.0
+        while True:
+            box = shapely.box(
+                minx - radius,
+                miny - radius,
+                maxx + radius,
+                maxy + radius,
+            )
+            candidates = self.tree.query(box)
+            candidates = candidates[self.remaining[candidates]]
+            if len(candidates) == 0:
+                radius = max(2 * radius, line.length, 1e-09)
+                continue
+
+            closest = shapely.distance(line, self.lines[candidates]).min()
+            if closest <= radius:
+                return closest
+            radius = closest
+
+
+def pick_edge(edges, segment_index: SegmentIndex):
     """Pick an edge to traverse next."""
 
     # The sort key is as follows: first prefer to always take a segment edge if
     # possible, then prefer the edge that is closest to an unvisited grating
     # segment, where closest is geometrically. Closest could be defined by
     # traversing graph edges instead, but this is good enough.
-    def dist_to_closest_segment(edge):
-        source, target, _ = edge
-        edge_line = geo.LineString([source, target])
-        return min(
-            edge_line.distance(geo.LineString([e[0], e[1]])) for e in segment_edges
-        )
+    #
+    # No edge can beat a distance of zero, so the first such edge is returned
+    # without computing distances for the rest.
+    best_edge, best_value = None, math.inf
+    for edge in edges:
+        source, target, key = edge
+        if key == "segment":
+            return edge
+        value = segment_index.distance_to_closest(geo.LineString([source, target]))
+        if value == 0:
+            return edge
+        if value < best_value:
+            best_edge, best_value = edge, value
+    return best_edge
+
+
+def rotation(angle: float) -> np.ndarray:
+    """The matrix rotating row vectors counterclockwise by `angle`, as in `p @ R`."""
+    cos, sin = math.cos(angle), math.sin(angle)
+    return np.array([[cos, sin], [-sin, cos]])
+
+
+def grating_segments(
+    shape: geo.Polygon,
+    angle: float,
+    row_spacing: float,
+) -> List[GratingSegment]:
+    """Intersect a shape with a grating of parallel rows.
+
+    The rows make an angle of `angle` radians with the x-axis, and are spaced
+    `row_spacing` apart, aligned so that a row passes through the origin. The
+    output lists segments row by row, each row from one side to the other.
+
+    Rather than intersecting each row with the shape separately, this rotates
+    the shape's edges so the rows are horizontal, computes every crossing of
+    every row with every edge at once, and sorts the crossings by row and
+    position. Within a row, consecutive pairs of crossings enter and exit the
+    shape (the even-odd rule), so they are exactly the grating segments. Each
+    edge counts crossings in a half-open interval of heights, so that a row
+    through a shared vertex counts it once for each edge it enters or leaves.
+    """
+    polygons = getattr(shape, "geoms", [shape])
+    rings = [ring for p in polygons for ring in [p.exterior, *p.interiors]]
+    edge_starts, edge_ends = [], []
+    for ring in rings:
+        coords = shapely.get_coordinates(ring)
+        edge_starts.append(coords[:-1])
+        edge_ends.append(coords[1:])
+    x0, y0 = (np.concatenate(edge_starts) @ rotation(-angle)).T
+    x1, y1 = (np.concatenate(edge_ends) @ rotation(-angle)).T
+
+    # Edge i crosses rows first_row[i], ..., first_row[i] + row_counts[i] - 1
+    first_row = np.ceil(np.minimum(y0, y1) / row_spacing).astype(int)
+    row_counts = np.ceil(np.maximum(y0, y1) / row_spacing).astype(int) - first_row
+
+    edges = np.repeat(np.arange(len(x0)), row_counts)
+    edge_offsets = np.repeat(np.cumsum(row_counts) - row_counts, row_counts)
+    rows = first_row[edges] + np.arange(len(edges)) - edge_offsets
+    y = rows * row_spacing
+    x = x0[edges] + (y - y0[edges]) * (x1 - x0)[edges] / (y1 - y0)[edges]
 
-    values = {e: 0 if e[2] == "segment" else dist_to_closest_segment(e) for e in edges}
-    output = min(values, key=values.get)
-    return output
+    order = np.lexsort((x, rows))
+    x, y = x[order], y[order]
+    starts = np.stack([x[0::2], y[0::2]], axis=1) @ rotation(angle)
+    ends = np.stack([x[1::2], y[1::2]], axis=1) @ rotation(angle)
+    # Rows through a vertex at a local minimum of the shape produce a
+    # zero-length segment.
+    nonempty = x[1::2] > x[0::2]
+    return [
+        (tuple(start), tuple(end))
+        for start, end in zip(starts[nonempty].tolist(), ends[nonempty].tolist())
+    ]
 
 
 def find_stitch_path(
@@ -69,6 +231,7 @@ def find_stitch_path(
     grating_segments: Iterable[GratingSegment],
     starting_point: Point,
 ) -> List[Edge]:
+    grating_segments = list(grating_segments)
     graph = networkx.MultiGraph()
     for segment in grating_segments:
         graph.add_edge(segment[0], segment[1], key="segment")
@@ -78,31 +241,23 @@ def find_stitch_path(
     # the shape can be arbitrarily complex: non-convex and with holes in the
     # interior. The shapely library handles the geometry of distinguishing
     # the multiple boundary/hole outlines.
-    shape_outlines = list(enumerate(outlines(shape)))
-    for node in graph.nodes():
-        pt = geo.Point(node)
-
-        def distance(outline_index):
-            index, outline = outline_index
-            return outline.distance(pt)
-
-        # All points should lie exactly on an outline, but floating point approximations
-        # may break an exact intersection check.
-        index, outline = min(shape_outlines, key=distance)
-        # add_node just updates node data when the input node already exists
-        # (as determined by its hash). `outline.project(pt)` returns the
-        # distance along the outline from the start of the outline's path to the
-        # closest point on the outline to `pt`.
-        graph.add_node(node, outline=index, order=outline.project(pt))
-
-    for nodes in sorted_grouped_by_outline(graph).values():
-        for i, (node1, node2) in enumerate(pairwise_cyclic(nodes)):
+    #
+    # All points should lie exactly on an outline, but floating point
+    # approximations may break an exact intersection check, so each node is
+    # assigned to its closest outline. This is done for all nodes at once.
+    nodes = list(graph.nodes())
+    outline_indices, orders = assign_to_outlines(list(outlines(shape)), nodes)
+
+    grouped = sorted_grouped_by_outline(nodes, outline_indices, orders)
+    for outline_nodes in grouped.values():
+        for i, (node1, node2) in enumerate(pairwise_cyclic(outline_nodes)):
             graph.add_edge(node1, node2, key="outline")
             # This extra edge ensures every node in the graph has degree 4, and
             # hence that an Eulerian path exists.
             if i % 2 == 0:
                 graph.add_edge(node1, node2, key="extra")
 
+    segment_index = SegmentIndex(grating_segments)
     path: Deque[Edge] = deque([])
     vertex_stack = [starting_point]
     last_vertex = None
@@ -115,19 +270,146 @@ def find_stitch_path(
             last_vertex = current_vertex
             vertex_stack.pop()
         else:
-            # This could be made more efficient by keeping track of the
-            # remaining segment edges as you go.
-            segment_edges = {e for e in graph.edges(keys=True) if e[2] == "segment"}
-            if not segment_edges:
+            if not segment_index:
                 graph.clear_edges()
                 continue
 
             source, target, key = pick_edge(
                 graph.edges(current_vertex, keys=True),
-                segment_edges,
+                segment_index,
             )
             if target:
                 vertex_stack.append(target)
                 graph.remove_edge(source, target, key=key)
+                if key == "segment":
+                    segment_index.remove(source, target)
 
     return list(path)
+
+
+# A fill region to plan: (shape, grating_segments, starting_point)
+FillJob = Tuple[geo.Polygon, List[GratingSegment], Point]
+
+
+@dataclass
+class MultiRegionStitchPlan:
+    # The stitch path of each region, listed in the order they are sewn.
+    paths: List[List[Edge]]
+    # order[i] is the index of the job whose path is paths[i].
+    order: List[int]
+    # The total length of the jump stitches between consecutive regions,
+    # including the jump from the origin to the first region.
+    jump_distance: float
+    planning_seconds: float
+
+
+def _find_stitch_path_for_job(job: FillJob) -> List[Edge]:
+    return find_stitch_path(*job)
+
+
+def endpoints(path: List[Edge], starting_point: Point) -> Tuple[Point, Point]:
+    if not path:
+        return starting_point, starting_point
+    return path[0][0], path[-1][1]
+
+
+def jump_distance(
+    origin: Point,
+    entries: List[Point],
+    exits: List[Point],
+    order: List[int],
+) -> float:
+    positions = [origin] + [exits[i] for i in order[:-1]]
+    return sum(math.dist(p, entries[i]) for (p, i) in zip(positions, order))
+
+
+def order_regions(origin: Point, entries: List[Point], exits: List[Point]) -> List[int]:
+    """Choose an order to sew regions in that keeps jump stitches short.
+
+    Regions are sewn from their fixed entry point to their fixed exit point, so
+    the cost of jumping from region i to region j is the distance from the exit
+    of i to the entry of j, which is not symmetric. A greedy nearest-neighbor
+    tour is improved by 2-opt moves, which reverse the order in which a
+    contiguous run of regions is visited.
+    """
+    n = len(entries)
+    if n == 0:
+        return []
+
+    # jumps[i][j] is the cost of jumping from the exit of i to the entry of j,
+    # where index n stands in for the origin.
+    jumps = cdist(np.array(exits + [origin]), np.array(entries + [origin]))
+
+    order = []
+    unvisited = set(range(n))
+    current = n
+    while unvisited:
+        current = min(unvisited, key=lambda j: jumps[current][j])
+        order.append(current)
+        unvisited.remove(current)
+
+    improved = True
+    while improved:
+        improved = False
+        tour = [n] + order
+        # forward[k] and backward[k] are the costs of traversing tour[1..k]
+        # in either direction, so that reversals can be scored in O(1).
+        forward, backward = [0.0, 0.0], [0.0, 0.0]
+        for a, b in pairwise(tour[1:]):
+            forward.append(forward[-1] + jumps[a][b])
+            backward.append(backward[-1] + jumps[b][a])
+
+        for i in range(1, n):
+            for j in range(i + 1, n + 1):
+                before, first, last = tour[i - 1], tour[i], tour[j]
+                old = jumps[before][first] + forward[j] - forward[i]
+                new = jumps[before][last] + backward[j] - backward[i]
+                if j < n:
+                    old += jumps[last][tour[j + 1]]
+                    new += jumps[first][tour[j + 1]]
+                if new < old - 1e-09:
+                    order[i - 1 : j] = reversed(order[i - 1 : j])
+                    improved = True
+                    break
+            if improved:
+                break
+
+    return order
+
+
+def find_stitch_paths(
+    jobs: Iterable[FillJob],
+    origin: Optional[Point] = None,
+    processes: Optional[int] = None,
+) -> MultiRegionStitchPlan:
+    """Plan the stitch paths of many independent fill regions.
+
+    Each job is planned with `find_stitch_path` in a pool of worker processes
+    (or in this process if `processes` is 1), and the regions are then ordered
+    to minimize the jump stitches between them, starting from `origin` (which
+    defaults to the first job's starting point).
+    """
+    start = time.perf_counter()
+    jobs = list(jobs)
+    if processes == 1:
+        paths = [_find_stitch_path_for_job(job) for job in jobs]
+    else:
+        with ProcessPoolExecutor(max_workers=processes) as executor:
+            paths = list(executor.map(_find_stitch_path_for_job, jobs))
+
+    entries, exits = [], []
+    for path, (_, _, starting_point) in zip(paths, jobs):
+        entry_point, exit_point = endpoints(path, starting_point)
+        entries.append(entry_point)
+        exits.append(exit_point)
+
+    if origin is None:
+        origin = jobs[0][2] if jobs else (0.0, 0.0)
+    order = order_regions(origin, entries, exits)
+
+    return MultiRegionStitchPlan(
+        paths=[paths[i] for i in order],
+        order=order,
+        jump_distance=jump_distance(origin, entries, exits, order),
+        planning_seconds=time.perf_counter() - start,
+    )
@@ -1,5 +1,6 @@
 import math
 import random
+from dataclasses import replace
 
 import hypothesis
 import matplotlib.pyplot as plt
@@ -10,7 +11,16 @@ from hypothesis.strategies import composite, floats, integers
 from matplotlib.patches import FancyArrowPatch
 from shapely import geometry as geo
 
-from tips.autofill import find_stitch_path
+from tips.autofill import (
+    SegmentIndex,
+    assign_to_outlines,
+    find_stitch_path,
+    find_stitch_paths,
+    grating_segments,
+    jump_distance,
+    order_regions,
+    outlines,
+)
 
 
 def test_fill_box():
@@ -107,6 +117,133 @@ def test_box_with_hole_non_aligned_grating():
     # draw_line_segments(output)
 
 
+def test_segment_index_distance_matches_brute_force():
+    random.seed(1)
+    segments = []
+    for _ in range(50):
+        x, y = random.uniform(0, 20), random.uniform(0, 20)
+        segments.append(((x, y), (x + random.uniform(0.5, 3), y)))
+    index = SegmentIndex(segments)
+
+    for i, (source, target) in enumerate(segments[:40]):
+        index.remove(source, target)
+        remaining = [geo.LineString(s) for s in segments[i + 1 :]]
+        for _ in range(10):
+            x, y = random.uniform(-5, 25), random.uniform(-5, 25)
+            line = geo.LineString([(x, y), (x + 1, y + 1)])
+            expected = min(line.distance(s) for s in remaining)
+            assert abs(index.distance_to_closest(line) - expected) < 1e-09
+
+    assert len(index) == 10
+
+
+def test_assign_to_outlines_matches_project():
+    box_with_holes = (
+        geo.box(0, 0, 20, 20, ccw=True)
+        .difference(geo.Point(5, 5).buffer(2))
+        .difference(geo.Point(14, 12).buffer(3))
+    )
+    shape_outlines = list(outlines(box_with_holes))
+    random.seed(1)
+    nodes = []
+    for _ in range(200):
+        outline = random.choice(shape_outlines)
+        pt = outline.interpolate(random.uniform(0, outline.length))
+        nodes.append((pt.x, pt.y))
+
+    outline_indices, orders = assign_to_outlines(shape_outlines, nodes)
+
+    for node, outline_index, order in zip(nodes, outline_indices, orders):
+        pt = geo.Point(node)
+        expected_index, expected_outline = min(
+            enumerate(shape_outlines),
+            key=lambda x: x[1].distance(pt),
+        )
+        assert outline_index == expected_index
+        assert order == expected_outline.project(pt)
+
+
+def box_job(x, y):
+    shape = geo.box(x, y, x + 3, y + 3, ccw=True)
+    grating_segments = [((x, y + i), (x + 3, y + i)) for i in range(4)]
+    return shape, grating_segments, (x, y)
+
+
+def test_find_stitch_paths_matches_find_stitch_path():
+    jobs = [box_job(10 * i, 10 * j) for i in range(3) for j in range(3)]
+    random.seed(1)
+    random.shuffle(jobs)
+
+    plan = find_stitch_paths(jobs, origin=(0, 0), processes=2)
+
+    assert sorted(plan.order) == list(range(len(jobs)))
+    for path, job_index in zip(plan.paths, plan.order):
+        assert path == find_stitch_path(*jobs[job_index])
+    assert plan == replace(
+        find_stitch_paths(jobs, origin=(0, 0), processes=1),
+        planning_seconds=plan.planning_seconds,
+    )
+
+
+def test_order_regions_beats_input_order():
+    random.seed(1)
+    entries = [(random.uniform(0, 100), random.uniform(0, 100)) for _ in range(50)]
+    exits = [(random.uniform(0, 100), random.uniform(0, 100)) for _ in range(50)]
+    origin = (0, 0)
+    input_order = list(range(50))
+
+    order = order_regions(origin, entries, exits)
+
+    assert sorted(order) == input_order
+    assert jump_distance(origin, entries, exits, order) < 0.5 * jump_distance(
+        origin,
+        entries,
+        exits,
+        input_order,
+    )
+
+
+def test_grating_segments_box():
+    shape = geo.box(10, 10, 13, 12.5, ccw=True)
+    expected = [
+        ((10.0, 10.0), (13.0, 10.0)),
+        ((10.0, 11.0), (13.0, 11.0)),
+        ((10.0, 12.0), (13.0, 12.0)),
+    ]
+    assert grating_segments(shape, angle=0, row_spacing=1) == expected
+
+
+def test_grating_segments_agree_with_shapely_intersection():
+    box_with_hole = geo.box(10, 10, 16, 16, ccw=True).difference(
+        geo.Point(13, 13).buffer(1.5),
+    )
+    angle = math.pi / 6
+    row_spacing = 0.5
+    segments = grating_segments(box_with_hole, angle, row_spacing)
+
+    direction = (math.cos(angle), math.sin(angle))
+    normal = (-direction[1], direction[0])
+    rows = {}
+    for segment in segments:
+        start, end = segment
+        assert geo.LineString(segment).within(box_with_hole.buffer(1e-09))
+        row = round((start[0] * normal[0] + start[1] * normal[1]) / row_spacing)
+        rows[row] = rows.get(row, 0) + math.dist(start, end)
+
+    for row, length in rows.items():
+        center = (row * row_spacing * normal[0], row * row_spacing * normal[1])
+        line = geo.LineString(
+            [
+                (center[0] - 100 * direction[0], center[1] - 100 * direction[1]),
+                (center[0] + 100 * direction[0], center[1] + 100 * direction[1]),
+            ],
+        )
+        assert abs(line.intersection(box_with_hole).length - length) < 1e-09
+
+    # assert no error
+    find_stitch_path(box_with_hole, segments, segments[0][0])
+
+
 @composite
 def random_shape_difference(draw, min_points=3, max_points=10):
     """Generate a matrix, and a kernel with strictly smaller dimension."""
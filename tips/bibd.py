@@ -1,9 +1,9 @@
 """A balanced incomplete block design with parameters (15, 3, 1)."""
 
-from collections import defaultdict
 from dataclasses import dataclass
-from itertools import combinations
-from typing import Collection, DefaultDict, Tuple
+from typing import Collection, Dict, Hashable, List, Tuple, Union
+
+import numpy as np
 
 BIBD = Collection[Collection[str]]
 
@@ -179,41 +179,77 @@ class BIBDParams:
         )
 
 
-def is_bibd(bibd: BIBD) -> bool:
-    """Determine if a given list of blocks is a BIBD."""
-    block_sizes = {len(block) for block in bibd}
-    if len(block_sizes) != 1:
-        print(f"Block sizes = {block_sizes}")
-        return False
+def to_block_array(bibd: BIBD) -> Tuple[List[Hashable], np.ndarray]:
+    """Map treatments to integers 0..v-1 and stack the blocks into an array.
 
-    element_memberships: DefaultDict[str, int] = defaultdict(int)
-    pairwise_memberships: DefaultDict[Tuple[str, str], int] = defaultdict(int)
+    Returns the list of treatments, in order of first appearance, and an int
+    array of shape (b, k) whose rows are the blocks. All blocks must have the
+    same size.
+    """
+    index: Dict[Hashable, int] = dict()
+    rows = [[index.setdefault(x, len(index)) for x in block] for block in bibd]
+    block_array = np.array(rows, dtype=np.int64).reshape(len(rows), -1)
+    return list(index), block_array
 
-    for block in bibd:
-        for element in block:
-            element_memberships[element] += 1
-        for elt1, elt2 in combinations(block, 2):
-            sorted_members = (elt1, elt2) if elt1 < elt2 else (elt2, elt1)
-            pairwise_memberships[sorted_members] += 1
 
-    if len(set(element_memberships.values())) != 1:
-        print(f"Element memberships = {element_memberships}")
-        return False
+def pair_index(i: np.ndarray, j: np.ndarray, v: int) -> np.ndarray:
+    """The position of pair (i, j), i < j, in a flattened upper triangle."""
+    return i * (2 * v - i - 1) // 2 + (j - i - 1)
 
-    if len(set(pairwise_memberships.values())) != 1:
-        min_entry = min(pairwise_memberships.items(), key=lambda x: x[1])
-        max_entry = max(pairwise_memberships.items(), key=lambda x: x[1])
-        print(f"Pairwise memberships not all equal = {min_entry, max_entry}")
-        return False
 
-    n = len(element_memberships.keys())
-    if len(pairwise_memberships.keys()) != n * (n - 1) / 2:
+def is_bibd(bibd: Union[BIBD, np.ndarray], chunk_size: int = 1 << 20) -> bool:
+    """Determine if a given list of blocks is a BIBD.
+
+    The blocks may also be given as an int array of shape (b, k) whose rows are
+    blocks over the treatments 0..v-1, as produced by to_block_array.
+
+    Pair counts are accumulated into a dense upper-triangular array, about
+    chunk_size pairs at a time. Since the replication number r fixes lambda
+    = r(k-1)/(v-1), the check stops at the first pair that occurs too often.
+    """
+    if isinstance(bibd, np.ndarray):
+        blocks = bibd
+    else:
+        block_sizes = {len(block) for block in bibd}
+        if len(block_sizes) != 1:
+            print(f"Block sizes = {block_sizes}")
+            return False
+        _, blocks = to_block_array(bibd)
+
+    b, k = blocks.shape
+    v = int(blocks.max()) + 1
+    element_memberships = np.bincount(blocks.ravel(), minlength=v)
+    if element_memberships.min() != element_memberships.max():
         print(
-            "Not all pairs represented. Only found "
-            f"{len(pairwise_memberships.keys())} when expecting {n * (n-1) / 2}",
+            "Element memberships not all equal = "
+            f"{element_memberships.min(), element_memberships.max()}",
         )
         return False
 
+    r = int(element_memberships[0])
+    lambda_, remainder = divmod(r * (k - 1), v - 1) if v > 1 else (0, 1)
+    if remainder or lambda_ == 0:
+        print(f"No lambda is possible for v={v}, k={k}, r={r}")
+        return False
+
+    first, second = np.triu_indices(k, 1)
+    pair_counts = np.zeros(v * (v - 1) // 2, dtype=np.int64)
+    blocks_per_chunk = max(1, chunk_size // len(first))
+    for start in range(0, b, blocks_per_chunk):
+        chunk = np.sort(blocks[start : start + blocks_per_chunk], axis=1)
+        i, j = chunk[:, first].ravel(), chunk[:, second].ravel()
+        if (i == j).any():
+            print("Some block repeats a treatment")
+            return False
+        pairs = pair_index(i, j, v)
+        pair_counts += np.bincount(pairs, minlength=len(pair_counts))
+        if pair_counts[pairs].max() > lambda_:
+            print(f"Some pair occurs in more than lambda={lambda_} blocks")
+            return False
+
+    # The total pair count is b * k(k-1)/2 = lambda * v(v-1)/2 by the choice of
+    # lambda, so if no pair occurs too often, every pair occurs exactly lambda
+    # times.
     return True
 
 
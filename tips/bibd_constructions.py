@@ -0,0 +1,332 @@
+"""Algebraic constructions of balanced incomplete block designs.
+
+Each construction returns a block array: an int array of shape (b, k) whose
+rows are the blocks, over the treatments 0..v-1. This is the compact format
+accepted by tips.bibd.is_bibd, and incidence_matrix packs it into bits. All
+constructions take time linear in the size of the output, after building the
+arithmetic tables of a finite field of order q, which take O(q^2).
+"""
+
+from dataclasses import dataclass
+from typing import List, Tuple
+
+import numpy as np
+
+
+def prime_factors(n: int) -> List[int]:
+    """The distinct prime factors of n, in increasing order."""
+    factors = []
+    f = 2
+    while f * f <= n:
+        if n % f == 0:
+            factors.append(f)
+            while n % f == 0:
+                n //= f
+        f += 1
+    if n > 1:
+        factors.append(n)
+    return factors
+
+
+def as_prime_power(q: int) -> Tuple[int, int]:
+    """Return (p, m) with q = p^m and p prime, or raise ValueError."""
+    factors = prime_factors(q) if q > 1 else []
+    if len(factors) != 1:
+        raise ValueError(f"{q} is not a prime power")
+    p, m = factors[0], 0
+    while q > 1:
+        q //= p
+        m += 1
+    return p, m
+
+
+@dataclass(frozen=True)
+class GaloisField:
+    """The finite field GF(q), q = p^m, with elements 0..q-1.
+
+    An element is a polynomial over GF(p) of degree less than m, encoded by
+    its coefficients as the base-p digits of an int. Addition and
+    multiplication are precomputed q-by-q tables, which can be indexed by
+    numpy arrays of elements.
+    """
+
+    p: int
+    m: int
+    add: np.ndarray
+    mul: np.ndarray
+
+    @property
+    def order(self) -> int:
+        return self.p**self.m
+
+    @staticmethod
+    def create(q: int) -> "GaloisField":
+        p, m = as_prime_power(q)
+        exp = primitive_powers(p, m)
+        log = np.zeros(q, dtype=np.int64)
+        log[exp] = np.arange(q - 1)
+
+        elements = np.arange(q)
+        add = np.zeros((q, q), dtype=np.int64)
+        for place in (p**j for j in range(m)):
+            digits = elements // place % p
+            add += (digits[:, None] + digits[None, :]) % p * place
+
+        mul = exp[(log[:, None] + log[None, :]) % (q - 1)]
+        mul[0, :] = mul[:, 0] = 0
+        return GaloisField(p=p, m=m, add=add, mul=mul)
+
+
+def primitive_powers(p: int, m: int) -> np.ndarray:
+    """The powers x^0, ..., x^(p^m-2) of a generator x of GF(p^m)*.
+
+    Tries the monic polynomials x^m - (c_{m-1} x^{m-1} + ... + c_0) over GF(p)
+    until one has x as a primitive element, i.e., until the powers of x only
+    return to 1 after p^m - 1 steps.
+    """
+    q = p**m
+    for code in range(1, q):
+        c = [code // p**j % p for j in range(m)]
+        if c[0] == 0:
+            continue
+        powers = []
+        digits = [1] + [0] * (m - 1)
+        for _ in range(q - 1):
+            powers.append(sum(d * p**j for (j, d) in enumerate(digits)))
+            top = digits[-1]
+            digits = [(d + top * cj) % p for (d, cj) in zip([0] + digits[:-1], c)]
+            if digits == [1] + [0] * (m - 1):
+                break
+        if len(powers) == q - 1:
+            return np.array(powers, dtype=np.int64)
+    raise AssertionError("Every finite field has a primitive element")
+
+
+def affine_plane(q: int) -> np.ndarray:
+    """The affine plane AG(2, q), a (q^2, q, 1) design, for a prime power q.
+
+    The point (x, y) is the treatment x*q + y. The first q^2 blocks are the
+    lines y = m*x + c, in order of (m, c), and the last q blocks are the lines
+    x = c. Lines with the same slope are parallel, and together cover every
+    point once.
+    """
+    field = GaloisField.create(q)
+    x = np.arange(q)
+    # sloped[m, c, x] = x * q + (m * x + c)
+    sloped = x * q + field.add[field.mul[:, None, :], x[None, :, None]]
+    vertical = x[:, None] * q + x[None, :]
+    return np.concatenate([sloped.reshape(q * q, q), vertical])
+
+
+def projective_plane(q: int) -> np.ndarray:
+    """The projective plane PG(2, q), a (q^2+q+1, q+1, 1) design.
+
+    Extends the affine plane with one point at infinity per class of parallel
+    lines, the treatments q^2..q^2+q, and one line through all of them.
+    """
+    affine = affine_plane(q)
+    parallel_class = np.concatenate([np.repeat(np.arange(q), q), np.full(q, q)])
+    at_infinity = q * q + np.arange(q + 1)
+    return np.concatenate(
+        [
+            np.column_stack([affine, at_infinity[parallel_class]]),
+            at_infinity[None, :],
+        ],
+    )
+
+
+def cyclic_design(difference_set: np.ndarray, v: int) -> np.ndarray:
+    """Develop a (v, k, lambda) difference set into a design with v blocks.
+
+    The blocks are the translates D + i mod v, for i in 0..v-1.
+    """
+    return (np.asarray(difference_set)[None, :] + np.arange(v)[:, None]) % v
+
+
+def singer_difference_set(q: int) -> np.ndarray:
+    """A (q^2+q+1, q+1, 1) difference set, for a prime power q.
+
+    Builds GF(q^3) as GF(q)[x] / (x^3 - a2 x^2 - a1 x - a0), choosing the
+    coefficients so that x is primitive. The powers x^i, for i < q^2+q+1, are
+    representatives of the points of PG(2, q), and the points of the plane
+    spanned by 1 and x form a difference set.
+    """
+    field = GaloisField.create(q)
+    add, mul = field.add.tolist(), field.mul.tolist()
+    v = q * q + q + 1
+    group_order = q**3 - 1
+    one = (1, 0, 0)
+
+    def times(a, b, coefficients):
+        # Multiply two polynomials of degree at most 2, then reduce the terms
+        # of degree 4 and 3 with x^3 = a2 x^2 + a1 x + a0.
+        product = [0] * 5
+        for i, ai in enumerate(a):
+            for j, bj in enumerate(b):
+                product[i + j] = add[product[i + j]][mul[ai][bj]]
+        for degree in (4, 3):
+            top = product[degree]
+            for j, cj in enumerate(coefficients):
+                shifted = degree - 3 + j
+                product[shifted] = add[product[shifted]][mul[top][cj]]
+        return tuple(product[:3])
+
+    def power(coefficients, exponent):
+        result, base = one, (0, 1, 0)
+        while exponent:
+            if exponent & 1:
+                result = times(result, base, coefficients)
+            base = times(base, base, coefficients)
+            exponent >>= 1
+        return result
+
+    def x_is_primitive(coefficients):
+        return power(coefficients, group_order) == one and all(
+            power(coefficients, group_order // f) != one
+            for f in prime_factors(group_order)
+        )
+
+    coefficients = next(
+        (a0, a1, a2)
+        for a0 in range(1, q)
+        for a1 in range(q)
+        for a2 in range(q)
+        if x_is_primitive((a0, a1, a2))
+    )
+
+    members = []
+    element = one
+    for i in range(v):
+        if element[2] == 0:
+            members.append(i)
+        element = times(element, (0, 1, 0), coefficients)
+    return np.array(members, dtype=np.int64)
+
+
+def paley_difference_set(p: int) -> np.ndarray:
+    """The quadratic residues mod a prime p = 3 mod 4.
+
+    They form a (p, (p-1)/2, (p-3)/4) difference set.
+    """
+    if p % 4 != 3 or prime_factors(p) != [p]:
+        raise ValueError(f"{p} is not a prime congruent to 3 mod 4")
+    return np.unique(np.arange(1, p) ** 2 % p)
+
+
+def bose_triple_system(v: int) -> np.ndarray:
+    """Bose's Steiner triple system, a (v, 3, 1) design for v = 3 mod 6.
+
+    With v = 6n+3, the treatments are pairs (x, i) in Z_{2n+1} x Z_3, encoded
+    as i*(2n+1) + x. Uses the idempotent commutative quasigroup x o y =
+    (n+1)(x+y) mod 2n+1.
+    """
+    if v % 6 != 3:
+        raise ValueError(f"Bose's construction needs v = 3 mod 6, got {v}")
+    n = (v - 3) // 6
+    order = 2 * n + 1
+    x = np.arange(order)
+    vertical = np.column_stack([x, x + order, x + 2 * order])
+
+    first, second = np.triu_indices(order, 1)
+    product = (n + 1) * (first + second) % order
+    layers = []
+    for i in range(3):
+        j = (i + 1) % 3
+        layers.append(
+            np.column_stack(
+                [first + i * order, second + i * order, product + j * order],
+            ),
+        )
+    return np.concatenate([vertical] + layers)
+
+
+def skolem_triple_system(v: int) -> np.ndarray:
+    """Skolem's Steiner triple system, a (v, 3, 1) design for v = 1 mod 6.
+
+    With v = 6n+1, the treatments are pairs (x, i) in Z_{2n} x Z_3, encoded as
+    i*2n + x, and a point at infinity, encoded as 6n. Uses the half-idempotent
+    commutative quasigroup x o y = s((x+y) mod 2n), where s(2j) = j and s(2j+1)
+    = n+j, so that x o x = (x+n) o (x+n) = x for x < n.
+    """
+    if v % 6 != 1 or v == 1:
+        raise ValueError(f"Skolem's construction needs 1 < v = 1 mod 6, got {v}")
+    n = (v - 1) // 6
+    order = 2 * n
+    infinity = v - 1
+    x = np.arange(n)
+    vertical = np.column_stack([x, x + order, x + 2 * order])
+
+    through_infinity = []
+    for i in range(3):
+        j = (i + 1) % 3
+        through_infinity.append(
+            np.column_stack(
+                [np.full(n, infinity), x + n + i * order, x + j * order],
+            ),
+        )
+
+    first, second = np.triu_indices(order, 1)
+    total = (first + second) % order
+    product = np.where(total % 2 == 0, total // 2, n + total // 2)
+    layers = []
+    for i in range(3):
+        j = (i + 1) % 3
+        layers.append(
+            np.column_stack(
+                [first + i * order, second + i * order, product + j * order],
+            ),
+        )
+    return np.concatenate([vertical] + through_infinity + layers)
+
+
+def steiner_triple_system(v: int) -> np.ndarray:
+    """A (v, 3, 1) design, which exists exactly when v = 1 or 3 mod 6."""
+    if v % 6 == 3:
+        return bose_triple_system(v)
+    if v % 6 == 1 and v > 1:
+        return skolem_triple_system(v)
+    raise ValueError(f"No Steiner triple system exists for v={v}")
+
+
+def incidence_matrix(blocks: np.ndarray) -> np.ndarray:
+    """Pack a block array into a v-by-b incidence matrix of bits.
+
+    Row t has bit j set if treatment t is in block j, with each row packed
+    into bytes as by np.packbits, so the matrix takes v * ceil(b/8) bytes.
+    """
+    b, k = blocks.shape
+    v = int(blocks.max()) + 1
+    block_ids = np.repeat(np.arange(b), k)
+    packed = np.zeros((v, (b + 7) // 8), dtype=np.uint8)
+    bits = (128 >> (block_ids % 8)).astype(np.uint8)
+    np.bitwise_or.at(packed, (blocks.ravel(), block_ids // 8), bits)
+    return packed
+
+
+if __name__ == "__main__":  # pragma: no cover
+    import time
+
+    from tips.bibd import is_bibd
+
+    for name, construct, argument in [
+        ("projective plane", projective_plane, 61),
+        ("affine plane", affine_plane, 61),
+        (
+            "Singer cyclic design",
+            lambda q: cyclic_design(singer_difference_set(q), q * q + q + 1),
+            61,
+        ),
+        (
+            "Paley cyclic design",
+            lambda p: cyclic_design(paley_difference_set(p), p),
+            1019,
+        ),
+        ("Steiner triple system", steiner_triple_system, 3001),
+    ]:
+        start = time.perf_counter()
+        blocks = construct(argument)
+        elapsed = time.perf_counter() - start
+        print(
+            f"{name}({argument}): {blocks.shape[0]} blocks of size "
+            f"{blocks.shape[1]} in {elapsed:.3f}s, valid={is_bibd(blocks)}",
+        )
@@ -0,0 +1,117 @@
+import itertools
+
+import numpy as np
+import pytest
+
+from tips.bibd import BIBDParams, is_bibd
+from tips.bibd_constructions import (
+    GaloisField,
+    affine_plane,
+    as_prime_power,
+    cyclic_design,
+    incidence_matrix,
+    paley_difference_set,
+    projective_plane,
+    singer_difference_set,
+    steiner_triple_system,
+)
+
+PRIME_POWERS = [2, 3, 4, 5, 7, 8, 9, 16, 25, 27]
+
+
+def params(blocks):
+    return BIBDParams.from_bibd([list(block) for block in blocks])
+
+
+def test_as_prime_power():
+    assert as_prime_power(2) == (2, 1)
+    assert as_prime_power(81) == (3, 4)
+    for q in [1, 6, 12, 100]:
+        with pytest.raises(ValueError):
+            as_prime_power(q)
+
+
+@pytest.mark.parametrize("q", [2, 3, 4, 8, 9])
+def test_galois_field_axioms(q):
+    field = GaloisField.create(q)
+    add, mul = field.add, field.mul
+    elements = range(q)
+    for a, b, c in itertools.product(elements, repeat=3):
+        assert mul[a, add[b, c]] == add[mul[a, b], mul[a, c]]
+        assert add[a, add[b, c]] == add[add[a, b], c]
+        assert mul[a, mul[b, c]] == mul[mul[a, b], c]
+    for a in range(1, q):
+        assert sorted(mul[a]) == list(elements)
+        assert sorted(add[a]) == list(elements)
+
+
+@pytest.mark.parametrize("q", PRIME_POWERS)
+def test_affine_plane(q):
+    blocks = affine_plane(q)
+    assert is_bibd(blocks)
+    assert params(blocks) == BIBDParams(
+        treatments=q * q,
+        subjects=q * q + q,
+        subjects_per_treatment=q + 1,
+        treatments_per_subject=q,
+        subjects_per_treatment_pair=1,
+    )
+
+
+@pytest.mark.parametrize("q", PRIME_POWERS)
+def test_projective_plane(q):
+    blocks = projective_plane(q)
+    assert is_bibd(blocks)
+    assert blocks.shape == (q * q + q + 1, q + 1)
+
+
+@pytest.mark.parametrize("q", PRIME_POWERS)
+def test_singer_difference_set(q):
+    v = q * q + q + 1
+    difference_set = singer_difference_set(q)
+    assert len(difference_set) == q + 1
+
+    differences = (difference_set[:, None] - difference_set[None, :]) % v
+    off_diagonal = differences[~np.eye(q + 1, dtype=bool)]
+    assert sorted(off_diagonal) == list(range(1, v))
+
+    assert is_bibd(cyclic_design(difference_set, v))
+
+
+@pytest.mark.parametrize("p", [7, 11, 19, 23, 31, 43])
+def test_paley_difference_set(p):
+    blocks = cyclic_design(paley_difference_set(p), p)
+    assert is_bibd(blocks)
+    assert params(blocks).lambda_ == (p - 3) // 4
+
+
+def test_paley_difference_set_needs_prime_3_mod_4():
+    for p in [5, 13, 15, 27]:
+        with pytest.raises(ValueError):
+            paley_difference_set(p)
+
+
+@pytest.mark.parametrize("v", [3, 7, 9, 13, 15, 19, 21, 25, 27, 31, 33, 99, 103])
+def test_steiner_triple_system(v):
+    blocks = steiner_triple_system(v)
+    assert blocks.shape == (v * (v - 1) // 6, 3)
+    assert is_bibd(blocks)
+
+
+@pytest.mark.parametrize("v", [1, 2, 4, 5, 6, 8, 11])
+def test_no_steiner_triple_system(v):
+    with pytest.raises(ValueError):
+        steiner_triple_system(v)
+
+
+def test_incidence_matrix():
+    blocks = projective_plane(3)
+    packed = incidence_matrix(blocks)
+    assert packed.shape == (13, 2)
+
+    incidence = np.unpackbits(packed, axis=1, count=len(blocks)).astype(bool)
+    for j, block in enumerate(blocks):
+        assert set(np.flatnonzero(incidence[:, j])) == set(block)
+    # Every two lines of a projective plane meet in exactly one point.
+    meetings = incidence.T.astype(int) @ incidence.astype(int)
+    assert (meetings[~np.eye(len(blocks), dtype=bool)] == 1).all()
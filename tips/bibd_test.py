@@ -1,8 +1,20 @@
+from collections import Counter
 from dataclasses import replace
+from itertools import combinations
 
+import numpy as np
 import pytest
+from hypothesis import given, settings
+from hypothesis.strategies import integers, lists, sets
 
-from tips.bibd import ALL_BIBDS, BIBDParams, bibd_8_4_3, bibd_15_3_1, is_bibd
+from tips.bibd import (
+    ALL_BIBDS,
+    BIBDParams,
+    bibd_8_4_3,
+    bibd_15_3_1,
+    is_bibd,
+    to_block_array,
+)
 
 
 @pytest.mark.parametrize("bibd", ALL_BIBDS)
@@ -17,6 +29,53 @@ def test_dropping_a_block_breaks_bibd(bibd):
         assert not is_bibd(dropped_one_block)
 
 
+def brute_force_is_bibd(blocks):
+    if len({len(block) for block in blocks}) != 1:
+        return False
+    treatments = {x for block in blocks for x in block}
+    memberships = Counter(x for block in blocks for x in block)
+    pairs = Counter(
+        frozenset(pair) for block in blocks for pair in combinations(block, 2)
+    )
+    return (
+        len(set(memberships.values())) == 1
+        and len(pairs) == len(treatments) * (len(treatments) - 1) // 2
+        and len(set(pairs.values())) == 1
+    )
+
+
+@settings(deadline=None)
+@given(
+    lists(
+        sets(integers(min_value=0, max_value=6), min_size=3, max_size=3),
+        min_size=1,
+        max_size=14,
+    ),
+)
+def test_is_bibd_agrees_with_brute_force(blocks):
+    blocks = [sorted(block) for block in blocks]
+    assert is_bibd(blocks) == brute_force_is_bibd(blocks)
+
+
+def test_is_bibd_block_array():
+    treatments, blocks = to_block_array(bibd_15_3_1)
+    assert sorted(treatments) == sorted("0123456789abcde")
+    assert blocks.shape == (35, 3)
+    assert is_bibd(blocks, chunk_size=10)
+    assert not is_bibd(blocks[1:], chunk_size=10)
+
+
+def test_is_bibd_large_design():
+    # All pairs of 1000 treatments, a (1000, 2, 1) design with half a million
+    # blocks.
+    first, second = np.triu_indices(1000, 1)
+    blocks = np.stack([first, second], axis=1)
+    assert is_bibd(blocks)
+
+    blocks[-1] = blocks[0]
+    assert not is_bibd(blocks)
+
+
 def test_different_block_sizes_break_bibd():
     assert not is_bibd(((1, 2), (1, 2, 3)))
 
@@ -0,0 +1,226 @@
+"""Search for a nearly balanced incomplete block design.
+
+When no BIBD exists for the layout of an experiment (v treatments, b subjects,
+k treatments per subject), or none is known, simulated annealing can still find
+a design whose pairs of treatments are as evenly covered as possible.
+
+Every treatment is applied to r or r+1 subjects, and a move swaps two
+treatments between two blocks, which keeps the replication numbers fixed. The
+search minimizes the sum of squared pair concurrences, which for a fixed
+number of pairs is smallest when all concurrences are equal, and is a standard
+stand-in for the efficiency factor: a move changes O(k) concurrences, so its
+cost can be computed in O(k), while the efficiency factor needs an eigenvalue
+decomposition. Restarts are run in parallel and the most efficient design is
+returned.
+"""
+
+import math
+import os
+import random
+import time
+from concurrent.futures import ProcessPoolExecutor
+from dataclasses import dataclass
+from typing import Dict, Optional, Tuple
+
+import numpy as np
+
+
+@dataclass
+class SearchResult:
+    """A block design as a (b, k) block array over the treatments 0..v-1."""
+
+    blocks: np.ndarray
+    efficiency_factor: float
+    sum_of_squares: int
+    moves: int
+    # Seconds spent annealing, not counting setup.
+    elapsed: float
+
+
+def concurrence_matrix(blocks: np.ndarray, v: int) -> np.ndarray:
+    """The v-by-v matrix whose (i, j) entry is the number of blocks with i and j.
+
+    The diagonal holds the replication number of each treatment.
+    """
+    incidence = np.zeros((v, len(blocks)), dtype=np.int64)
+    incidence[blocks, np.arange(len(blocks))[:, None]] = 1
+    return incidence @ incidence.T
+
+
+def efficiency_factor(blocks: np.ndarray, v: int) -> float:
+    """The efficiency factor of a (possibly unbalanced) block design.
+
+    This is the harmonic mean of the nonzero eigenvalues of the information
+    matrix C = R - N N^T / k, scaled by the mean replication number, where N is
+    the incidence matrix and R its diagonal of replication numbers. For a BIBD
+    it equals BIBDParams.efficiency_factor, and it is zero if the design
+    leaves some treatments incomparable.
+    """
+    k = blocks.shape[1]
+    concurrence = concurrence_matrix(blocks, v)
+    replication = np.diag(concurrence)
+    information = np.diag(replication) - concurrence / k
+    eigenvalues = np.linalg.eigvalsh(information)[1:]
+    if eigenvalues[0] < 1e-9:
+        return 0.0
+    return float((v - 1) / (replication.mean() * np.sum(1 / eigenvalues)))
+
+
+def sum_of_squares_lower_bound(v: int, b: int, k: int) -> int:
+    """The smallest possible sum of squared off-diagonal concurrences.
+
+    Reached when every pair is covered floor(lambda) or ceil(lambda) times,
+    where lambda is the mean concurrence.
+    """
+    num_pairs = v * (v - 1) // 2
+    total = b * k * (k - 1) // 2
+    low, extra = divmod(total, num_pairs)
+    return (num_pairs - extra) * low**2 + extra * (low + 1) ** 2
+
+
+def anneal(
+    v: int,
+    b: int,
+    k: int,
+    time_budget: float,
+    seed: int = 0,
+    initial_temperature: float = 4.0,
+    final_temperature: float = 0.05,
+    max_moves: Optional[int] = None,
+) -> SearchResult:
+    """Run simulated annealing from a random equireplicate design.
+
+    The temperature decreases geometrically with the elapsed fraction of the
+    time budget, or with the fraction of max_moves made if that is given,
+    which makes the result depend only on the seed (as long as the time
+    budget does not run out first). Stops early if every pair concurrence is
+    as even as possible.
+    """
+    if not 2 <= k <= v:
+        raise ValueError(f"Need 2 <= k <= v, got k={k}, v={v}")
+    rng = random.Random(seed)
+    labels = list(range(v))
+    rng.shuffle(labels)
+    blocks = [[labels[(i * k + j) % v] for j in range(k)] for i in range(b)]
+    member = [set(block) for block in blocks]
+
+    concurrence = concurrence_matrix(np.array(blocks), v).tolist()
+    cost = sum(concurrence[i][j] ** 2 for i in range(v) for j in range(i + 1, v))
+    best_cost, best_blocks = cost, [list(block) for block in blocks]
+    target = sum_of_squares_lower_bound(v, b, k)
+
+    start = time.perf_counter()
+    temperature = initial_temperature
+    moves = 0
+    while cost > target and (max_moves is None or moves < max_moves):
+        if moves % 1000 == 0:
+            elapsed = (time.perf_counter() - start) / time_budget
+            if elapsed >= 1:
+                break
+            if max_moves is not None:
+                elapsed = moves / max_moves
+            temperature = (
+                initial_temperature
+                * (final_temperature / initial_temperature) ** elapsed
+            )
+        moves += 1
+
+        a, c = rng.randrange(b), rng.randrange(b)
+        i, j = rng.randrange(k), rng.randrange(k)
+        x, y = blocks[a][i], blocks[c][j]
+        if a == c or x in member[c] or y in member[a]:
+            continue
+
+        # x moves from block a to block c, and y from c to a. Each treatment z
+        # in a (other than x) loses a pair with x and gains one with y, and
+        # each z in c (other than y) the other way around.
+        change: Dict[Tuple[int, int], int] = dict()
+        for z in blocks[a]:
+            if z != x:
+                change[x, z] = change.get((x, z), 0) - 1
+                change[y, z] = change.get((y, z), 0) + 1
+        for z in blocks[c]:
+            if z != y:
+                change[y, z] = change.get((y, z), 0) - 1
+                change[x, z] = change.get((x, z), 0) + 1
+        delta = sum(2 * concurrence[p][q] * d + d * d for ((p, q), d) in change.items())
+
+        if delta <= 0 or rng.random() < math.exp(-delta / temperature):
+            for (p, q), d in change.items():
+                concurrence[p][q] += d
+                concurrence[q][p] += d
+            blocks[a][i], blocks[c][j] = y, x
+            member[a].remove(x)
+            member[a].add(y)
+            member[c].remove(y)
+            member[c].add(x)
+            cost += delta
+            if cost < best_cost:
+                best_cost, best_blocks = cost, [list(block) for block in blocks]
+
+    best = np.array(best_blocks)
+    return SearchResult(
+        blocks=best,
+        efficiency_factor=efficiency_factor(best, v),
+        sum_of_squares=best_cost,
+        moves=moves,
+        elapsed=time.perf_counter() - start,
+    )
+
+
+def search_block_design(
+    v: int,
+    b: int,
+    k: int,
+    time_budget: float = 10.0,
+    restarts: Optional[int] = None,
+    processes: Optional[int] = None,
+    max_moves: Optional[int] = None,
+) -> SearchResult:
+    """Find the most efficient design over several annealing restarts.
+
+    The search takes up to time_budget seconds in total: restarts run in
+    rounds of `processes` parallel processes, and each gets an equal share
+    of the budget. By default there is one process per CPU, and one restart
+    per process.
+    """
+    processes = processes or os.cpu_count() or 1
+    restarts = restarts or processes
+    rounds = -(-restarts // processes)
+    with ProcessPoolExecutor(max_workers=processes) as executor:
+        futures = [
+            executor.submit(
+                anneal,
+                v,
+                b,
+                k,
+                time_budget / rounds,
+                seed,
+                max_moves=max_moves,
+            )
+            for seed in range(restarts)
+        ]
+        results = [future.result() for future in futures]
+    return max(results, key=lambda result: result.efficiency_factor)
+
+
+if __name__ == "__main__":  # pragma: no cover
+    from tips.bibd import BIBDParams
+
+    # No BIBD exists with these parameters, since r(k-1) = 24 is not a
+    # multiple of v-1 = 14.
+    v, b, k = 15, 40, 3
+    params = BIBDParams(
+        treatments=v,
+        subjects=b,
+        subjects_per_treatment=b * k // v,
+        treatments_per_subject=k,
+        subjects_per_treatment_pair=b * k * (k - 1) // (v * (v - 1)),
+    )
+    print(f"Satisfies necessary conditions: {params.satisfies_necessary_conditions()}")
+    result = search_block_design(v, b, k, time_budget=5)
+    concurrences = concurrence_matrix(result.blocks, v)[np.triu_indices(v, 1)]
+    print(
+        f"Efficiency factor {result.efficiency_factor:.4f}, pair concurrences "
+        f"{np.bincount(concurrences)}, after {result.moves} moves",
+    )
@@ -0,0 +1,74 @@
+import numpy as np
+import pytest
+
+from tips.bibd import ALL_BIBDS, BIBDParams, is_bibd, to_block_array
+from tips.block_design_search import (
+    anneal,
+    concurrence_matrix,
+    efficiency_factor,
+    search_block_design,
+    sum_of_squares_lower_bound,
+)
+
+
+@pytest.mark.parametrize("bibd", ALL_BIBDS)
+def test_efficiency_factor_agrees_with_bibd_params(bibd):
+    _, blocks = to_block_array(bibd)
+    expected = BIBDParams.from_bibd(bibd).efficiency_factor()
+    assert efficiency_factor(blocks, blocks.max() + 1) == pytest.approx(expected)
+
+
+def test_efficiency_factor_of_disconnected_design():
+    blocks = np.array([[0, 1], [0, 1], [2, 3], [2, 3]])
+    assert efficiency_factor(blocks, 4) == 0
+
+
+def test_anneal_finds_fano_plane():
+    result = anneal(v=7, b=7, k=3, time_budget=5, seed=1)
+    assert is_bibd(result.blocks)
+    assert result.efficiency_factor == pytest.approx(7 / 9)
+
+
+@pytest.mark.parametrize("v, b, k", [(8, 10, 3), (10, 12, 4), (15, 40, 3)])
+def test_anneal_keeps_consistent_counts(v, b, k):
+    result = anneal(v, b, k, time_budget=0.2, seed=2)
+    concurrence = concurrence_matrix(result.blocks, v)
+
+    assert result.blocks.shape == (b, k)
+    assert all(len(set(block)) == k for block in result.blocks.tolist())
+    replication = np.diag(concurrence)
+    assert replication.max() - replication.min() <= 1
+    pairs = concurrence[np.triu_indices(v, 1)]
+    assert result.sum_of_squares == np.sum(pairs**2)
+    assert result.sum_of_squares >= sum_of_squares_lower_bound(v, b, k)
+    assert 0 < result.efficiency_factor < 1
+
+
+def test_search_block_design_picks_most_efficient_restart():
+    v, b, k = 9, 10, 4
+    # A move limit, far below what the time budget allows, makes each restart
+    # depend only on its seed.
+    result = search_block_design(
+        v,
+        b,
+        k,
+        time_budget=60,
+        restarts=3,
+        processes=2,
+        max_moves=3000,
+    )
+    restarts = [
+        anneal(v, b, k, time_budget=30, seed=seed, max_moves=3000) for seed in range(3)
+    ]
+    assert result.efficiency_factor == max(r.efficiency_factor for r in restarts)
+    assert result.efficiency_factor == pytest.approx(
+        efficiency_factor(result.blocks, v),
+    )
+
+
+def test_search_block_design_shares_the_time_budget():
+    # The sum of squares lower bound is not reachable here, so every restart
+    # uses its whole share of the budget: three rounds of two processes get
+    # half a second each.
+    result = search_block_design(9, 10, 4, time_budget=1.5, restarts=6, processes=2)
+    assert 0.5 <= result.elapsed < 1.0
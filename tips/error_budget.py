@@ -1,6 +1,11 @@
+import os
+from concurrent.futures import ProcessPoolExecutor
 from dataclasses import dataclass
 from datetime import timedelta
-from typing import List, Optional
+from typing import List, Optional, Sequence, Tuple, Union
+
+import numpy as np
+from numpy.lib.format import open_memmap
 
 # assume minute-aligned samples
 TimeSeries = List[int]
@@ -53,6 +58,199 @@ def error_budget_remaining(
     )
 
 
+def burn_rates(
+    remaining: np.ndarray,
+    growth_rate: np.ndarray,
+) -> Tuple[np.ndarray, np.ndarray]:
+    """The growth rates and minutes until exhausted, elementwise.
+
+    Like error_budget_remaining, growth rates that are (nearly) zero are
+    rounded to zero, and then the budget is never exhausted.
+    """
+    stable = np.abs(growth_rate) < 1e-06
+    minutes = np.where(
+        stable,
+        np.inf,
+        remaining / -np.where(stable, 1, growth_rate),
+    )
+    return np.where(stable, 0.0, growth_rate), minutes
+
+
+@dataclass
+class BurnRates:
+    """The state of many SLOs over several windows, after one sample.
+
+    Arrays are indexed by [slo] or [slo, window], and agree with
+    error_budget_remaining evaluated on each SLO's series so far. Where the
+    budget growth rate is (nearly) zero, minutes_until_exhausted is infinite.
+    """
+
+    violated: np.ndarray
+    budget_growth_rate: np.ndarray
+    minutes_until_exhausted: np.ndarray
+
+    def metric(self, slo: int, window: int) -> SloMetric:
+        """Convert to the SloMetric returned by error_budget_remaining."""
+        minutes = self.minutes_until_exhausted[slo, window]
+        return SloMetric(
+            violated=bool(self.violated[slo]),
+            budget_growth_rate=float(self.budget_growth_rate[slo, window]),
+            time_until_exhausted=(
+                timedelta(minutes=float(minutes)) if np.isfinite(minutes) else None
+            ),
+        )
+
+
+class BurnRateEvaluator:
+    """Track the error budgets of many SLOs as minute samples stream in.
+
+    Keeps a ring buffer of the last max(window_minutes) + 1 remaining budgets
+    of every SLO, so each new sample updates every window's growth rate in
+    O(1) per SLO, vectorized across all SLOs.
+    """
+
+    def __init__(self, budgets: Sequence[float], window_minutes: Sequence[int]):
+        self.budgets = np.asarray(budgets, dtype=float)
+        self.windows = np.asarray(window_minutes, dtype=np.int64)
+        self.size = int(self.windows.max()) + 1
+        self.history = np.zeros((self.size, len(self.budgets)), dtype=np.int64)
+        self.first = np.zeros(len(self.budgets), dtype=np.int64)
+        self.num_samples = 0
+
+    def update(self, requests: np.ndarray, errors: np.ndarray) -> BurnRates:
+        """Add the next minute's cumulative requests and errors of every SLO."""
+        remaining = np.trunc(self.budgets * requests).astype(np.int64) - errors
+        latest = self.num_samples
+        if latest == 0:
+            self.first[:] = remaining
+        self.history[latest % self.size] = remaining
+        self.num_samples += 1
+
+        previous = latest - self.windows
+        earlier = np.where(
+            (previous > 0)[:, None],
+            self.history[np.maximum(previous, 0) % self.size],
+            self.first[None, :],
+        )
+        growth_rate = ((remaining[None, :] - earlier) / self.windows[:, None]).T
+        growth_rate, minutes = burn_rates(remaining[:, None], growth_rate)
+        return BurnRates(
+            violated=remaining <= 0,
+            budget_growth_rate=growth_rate,
+            minutes_until_exhausted=minutes,
+        )
+
+
+@dataclass
+class SloSeries:
+    """The state of an SLO at every minute, as computed by backfill.
+
+    Entry t of each array agrees with error_budget_remaining evaluated on the
+    first t + 1 samples. Where the budget growth rate is (nearly) zero,
+    minutes_until_exhausted is infinite.
+    """
+
+    budget_remaining: np.ndarray
+    violated: np.ndarray
+    budget_growth_rate: np.ndarray
+    minutes_until_exhausted: np.ndarray
+
+
+def backfill(
+    requests: np.ndarray,
+    errors: np.ndarray,
+    budget: Union[float, np.ndarray],
+    window_minutes: int,
+) -> SloSeries:
+    """Evaluate error_budget_remaining at every minute in one vectorized pass.
+
+    The time series are along the last axis, so a (services, minutes) array
+    backfills many services at once, with budget either a float or an array
+    with one budget per service.
+    """
+    budget = np.asarray(budget, dtype=float)
+    if budget.ndim:
+        budget = budget[..., None]
+    remaining = np.trunc(budget * requests).astype(np.int64) - errors
+
+    minutes = np.arange(remaining.shape[-1])
+    earlier = remaining[..., np.maximum(minutes - window_minutes, 0)]
+    growth_rate, minutes_until_exhausted = burn_rates(
+        remaining,
+        (remaining - earlier) / window_minutes,
+    )
+    return SloSeries(
+        budget_remaining=remaining,
+        violated=remaining <= 0,
+        budget_growth_rate=growth_rate,
+        minutes_until_exhausted=minutes_until_exhausted,
+    )
+
+
+def backfill_services(
+    directory: str,
+    budgets: np.ndarray,
+    window_minutes: int,
+    start: int,
+    end: int,
+) -> None:
+    """Backfill the services start..end-1 of a directory, see backfill_directory."""
+    requests = np.load(os.path.join(directory, "requests.npy"), mmap_mode="r")
+    errors = np.load(os.path.join(directory, "errors.npy"), mmap_mode="r")
+    result = backfill(
+        np.asarray(requests[start:end]),
+        np.asarray(errors[start:end]),
+        budgets[start:end],
+        window_minutes,
+    )
+    for name, values in vars(result).items():
+        output = np.load(os.path.join(directory, f"{name}.npy"), mmap_mode="r+")
+        output[start:end] = values
+        output.flush()
+
+
+def backfill_directory(
+    directory: str,
+    budgets: np.ndarray,
+    window_minutes: int,
+    processes: Optional[int] = None,
+    services_per_task: int = 64,
+) -> None:
+    """Backfill memory-mapped columnar series of many services in parallel.
+
+    The directory holds requests.npy and errors.npy, each a (services,
+    minutes) array of cumulative counts, so each service's series is
+    contiguous on disk. The result is written next to them, as one
+    (services, minutes) array per field of SloSeries, and services are
+    processed in parallel in groups of services_per_task.
+    """
+    requests = np.load(os.path.join(directory, "requests.npy"), mmap_mode="r")
+    for name, dtype in [
+        ("budget_remaining", np.int64),
+        ("violated", bool),
+        ("budget_growth_rate", float),
+        ("minutes_until_exhausted", float),
+    ]:
+        path = os.path.join(directory, f"{name}.npy")
+        open_memmap(path, mode="w+", dtype=dtype, shape=requests.shape).flush()
+
+    num_services = requests.shape[0]
+    with ProcessPoolExecutor(max_workers=processes) as executor:
+        futures = [
+            executor.submit(
+                backfill_services,
+                directory,
+                budgets,
+                window_minutes,
+                start,
+                min(start + services_per_task, num_services),
+            )
+            for start in range(0, num_services, services_per_task)
+        ]
+        for future in futures:
+            future.result()
+
+
 if __name__ == "__main__":
     import random
     from datetime import datetime
@@ -67,19 +265,20 @@ if __name__ == "__main__":
     errors = list(accumulate([random.randint(0, 2 * i) for i in range(samples)]))
 
     budget = 0.35
+    series = backfill(np.array(requests), np.array(errors), budget, window_minutes=10)
     print("measurement_index, violated, budget_growth_rate, est_time_remaining")
     for index in range(5, 1000, 20):
-        result = error_budget_remaining(
-            requests[:index],
-            errors[:index],
-            budget,
-            window_minutes=10,
-        )
-        s = f"{index}, {result.violated}, {result.budget_growth_rate:.2f},"
-        if result.budget_growth_rate > 0 or result.violated:
+        violated = series.violated[index - 1]
+        growth_rate = series.budget_growth_rate[index - 1]
+        s = f"{index}, {violated}, {growth_rate:.2f},"
+        if growth_rate > 0 or violated:
             print(s)
         else:
-            print(f"{s} {result.time_until_exhausted}")
+            minutes = series.minutes_until_exhausted[index - 1]
+            remaining = (
+                timedelta(minutes=float(minutes)) if np.isfinite(minutes) else None
+            )
+            print(f"{s} {remaining}")
 
     # draw the estimated budget curve starting from index 600
     index = 600
@@ -1,9 +1,16 @@
 from datetime import timedelta
 
-from hypothesis import assume, example, given
+import numpy as np
+from hypothesis import assume, example, given, settings
 from hypothesis.strategies import floats, integers
 
-from tips.error_budget import SloMetric, error_budget_remaining
+from tips.error_budget import (
+    BurnRateEvaluator,
+    SloMetric,
+    backfill,
+    backfill_directory,
+    error_budget_remaining,
+)
 
 
 def test_no_errors_no_requests():
@@ -83,3 +90,82 @@ def test_positive_budget_growth_rate():
     # and we get one more error each time step.
     # measuring at index 20 means 780 remaining minutes
     assert actual.time_until_exhausted == timedelta(minutes=780)
+
+
+@settings(deadline=None, max_examples=20)
+@given(integers(min_value=0, max_value=10000))
+def test_burn_rate_evaluator_matches_error_budget_remaining(seed):
+    rng = np.random.default_rng(seed)
+    num_slos, num_samples = 5, 80
+    budgets = rng.uniform(0.01, 0.5, num_slos)
+    windows = [1, 5, 30]
+    requests = np.cumsum(rng.integers(0, 1000, (num_samples, num_slos)), axis=0)
+    errors = np.cumsum(rng.integers(0, 100, (num_samples, num_slos)), axis=0)
+    # Some SLOs see no traffic, so their budget growth rate is zero.
+    requests[:, 0] = errors[:, 0] = 0
+
+    evaluator = BurnRateEvaluator(budgets, windows)
+    for t in range(num_samples):
+        rates = evaluator.update(requests[t], errors[t])
+        for slo in range(num_slos):
+            for w, window in enumerate(windows):
+                expected = error_budget_remaining(
+                    requests[: t + 1, slo].tolist(),
+                    errors[: t + 1, slo].tolist(),
+                    budgets[slo],
+                    window_minutes=window,
+                )
+                assert rates.metric(slo, w) == expected
+
+
+def random_series(rng, num_services, num_samples):
+    requests = np.cumsum(rng.integers(0, 1000, (num_services, num_samples)), axis=1)
+    errors = np.cumsum(rng.integers(0, 100, (num_services, num_samples)), axis=1)
+    return requests, errors
+
+
+@settings(deadline=None, max_examples=20)
+@given(integers(min_value=0, max_value=10000), integers(min_value=1, max_value=100))
+def test_backfill_matches_error_budget_remaining(seed, window):
+    rng = np.random.default_rng(seed)
+    requests, errors = random_series(rng, 1, 60)
+    budget = rng.uniform(0.01, 0.5)
+
+    series = backfill(requests[0], errors[0], budget, window_minutes=window)
+
+    for t in range(60):
+        expected = error_budget_remaining(
+            requests[0, : t + 1].tolist(),
+            errors[0, : t + 1].tolist(),
+            budget,
+            window_minutes=window,
+        )
+        minutes = series.minutes_until_exhausted[t]
+        actual = SloMetric(
+            violated=bool(series.violated[t]),
+            budget_growth_rate=float(series.budget_growth_rate[t]),
+            time_until_exhausted=(
+                timedelta(minutes=float(minutes)) if np.isfinite(minutes) else None
+            ),
+        )
+        assert actual == expected
+
+
+def test_backfill_directory(tmp_path):
+    rng = np.random.default_rng(1)
+    requests, errors = random_series(rng, 10, 200)
+    budgets = rng.uniform(0.01, 0.5, 10)
+    np.save(tmp_path / "requests.npy", requests)
+    np.save(tmp_path / "errors.npy", errors)
+
+    backfill_directory(str(tmp_path), budgets, 15, processes=2, services_per_task=3)
+
+    expected = backfill(requests, errors, budgets, 15)
+    for name, values in vars(expected).items():
+        np.testing.assert_array_equal(np.load(tmp_path / f"{name}.npy"), values)
+    for service in range(10):
+        single = backfill(requests[service], errors[service], budgets[service], 15)
+        np.testing.assert_array_equal(
+            single.budget_growth_rate,
+            expected.budget_growth_rate[service],
+        )
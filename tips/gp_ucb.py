@@ -4,40 +4,51 @@ The Gaussain Process Regressor was adapted from the sci-kit learn implementation
 
 https://github.com/scikit-learn/scikit-learn/blob/8c9c1f27b7e21201cfffb118934999025fd50cca/sklearn/gaussian_process/_gpr.py
 """
-import itertools
+
+from concurrent.futures import ThreadPoolExecutor
 
 import numpy as np
 from scipy.linalg import cho_solve, cholesky, solve_triangular
 from scipy.spatial.distance import cdist
 
 
+def in_chunks(predict, X, chunk_size, threads):
+    """Apply predict to chunks of the rows of X, concatenating the results."""
+    X = np.asarray(X, dtype=float)
+    chunks = [X[i : i + chunk_size] for i in range(0, len(X), chunk_size)]
+    if threads == 1 or len(chunks) == 1:
+        results = [predict(chunk) for chunk in chunks]
+    else:
+        with ThreadPoolExecutor(max_workers=threads) as executor:
+            results = list(executor.map(predict, chunks))
+    if not results:
+        return np.zeros(0), np.zeros(0)
+    y_mean, y_std = (np.concatenate(r) for r in zip(*results))
+    return y_mean, y_std
+
+
 class GaussianProcessRegressor:
+    # added small noise to (a) ensure kernel matrix is positive definite,
+    # and (b) to model gaussian noise in the observations.
+    noise = 1e-10
+
     def kernel(self, X, Y=None):
         dists = cdist(X, X if Y is None else Y, metric="sqeuclidean")
         return np.exp(-0.5 * dists)
 
     def train(self, X, y):
         """Fit data to a standard Gaussian Process regression model."""
-        # Normalize training signals
-        self._y_train_mean = np.mean(y, axis=0)
-        self._y_train_std = np.std(y, axis=0)
-        if self._y_train_std == 0:
-            self._y_train_std = 1
-        y = (y - self._y_train_mean) / self._y_train_std
-
-        self.X_train_ = X
-        self.y_train_ = y
+        X = np.asarray(X, dtype=float)
+        y = np.asarray(y, dtype=float)
 
         # Precompute quantities required for predictions which are independent
         # of actual query points
         # Alg. 2.1, page 19, line 2 -> L = cholesky(K + sigma^2 I)
-        K = self.kernel(self.X_train_)
-        # added small noise to (a) ensure kernel matrix is positive definite,
-        # and (b) to model gaussian noise in the observations.
-        K[np.diag_indices_from(K)] += 1e-10
+        K = self.kernel(X)
+        K[np.diag_indices_from(K)] += self.noise
 
         try:
-            self.L_ = cholesky(K, lower=True)
+            L = cholesky(K, lower=True)
         except np.linalg.LinAlgError as exc:  # pragma: no cover
             exc.args = (
                 "Cholseky factorization failed, kernel might "
@@ -45,12 +56,144 @@ class GaussianProcessRegressor:
             ) + exc.args
             raise
 
-        # Alg 2.1, page 19, line 3 -> alpha = L^T \ (L \ y)
-        self.alpha_ = cho_solve((self.L_, True), self.y_train_)
+        self._n = len(X)
+        self._X = X.copy()
+        self._y = y.copy()
+        self._L = L
+        # L^-1 y and L^-1 1, from which alpha is computed for any normalization
+        # of y, and which grow by one entry per added observation.
+        self._z_y = solve_triangular(L, y, lower=True, check_finite=False)
+        self._z_1 = solve_triangular(L, np.ones(len(y)), lower=True, check_finite=False)
+        self._update_alpha()
+        return self
+
+    def add_observation(self, x, y):
+        """Add one training point to the model in O(n^2) time.
+
+        Instead of refactoring the kernel matrix, extend its Cholesky factor L
+        by one row: with k the kernel between the new point and the training
+        points, the new row is (r, d) with r = L^-1 k and d^2 = k(x, x) - r.r.
+        """
+        x = np.asarray(x, dtype=float).reshape(1, -1)
+        n = getattr(self, "_n", 0)
+        if n == 0:
+            return self.train(x, [y])
+        self._reserve(n + 1)
+
+        k = self.kernel(self._X[:n], x)[:, 0]
+        row = self._solve_lower(k)
+        d_squared = self.kernel(x)[0, 0] + self.noise - row @ row
+        if d_squared <= 0:  # pragma: no cover
+            raise np.linalg.LinAlgError(
+                "Cholseky factorization failed, kernel might "
+                "not be positive semidefinite",
+            )
+        d = np.sqrt(d_squared)
+
+        self._L[n, :n] = row
+        self._L[n, n] = d
+        self._X[n] = x[0]
+        self._y[n] = y
+        self._z_y[n] = (y - row @ self._z_y[:n]) / d
+        self._z_1[n] = (1 - row @ self._z_1[:n]) / d
+        self._n = n + 1
+        self._update_alpha()
+        return self
+
+    def __len__(self):
+        return getattr(self, "_n", 0)
+
+    def truncate(self, n):
+        """Forget all but the first n observations, e.g. to undo fantasies.
+
+        The forgotten rows of the Cholesky factor go back to the identity that
+        _solve_lower expects in the unused part of the buffer.
+        """
+        old_n = len(self)
+        if n >= old_n:
+            return self
+        self._L[n:old_n] = 0
+        self._L[np.arange(n, old_n), np.arange(n, old_n)] = 1
+        self._n = n
+        if n:
+            self._update_alpha()
         return self
 
-    def predict(self, X):
-        """Predict using the Gaussian process regression model."""
+    def _reserve(self, size):
+        """Grow the storage for training data geometrically, as a list would."""
+        capacity = len(self._y)
+        if size <= capacity:
+            return
+        capacity = max(size, 2 * capacity)
+        n = self._n
+        # The unused part of the buffer holds an identity matrix, so that
+        # triangular solves can use the whole (contiguous) buffer, see
+        # _solve_lower.
+        L = np.eye(capacity)
+        L[:n, :n] = self._L[:n, :n]
+        self._L = L
+        for name in ["_X", "_y", "_z_y", "_z_1"]:
+            old = getattr(self, name)
+            new = np.zeros((capacity,) + old.shape[1:])
+            new[:n] = old[:n]
+            setattr(self, name, new)
+
+    def _solve_lower(self, b, transpose=False):
+        """Solve L x = b, or L^T x = b, for the current training points.
+
+        Solving with a slice of the buffer would copy it, and the identity in
+        the unused part of the buffer leaves the first n entries unchanged.
+        """
+        n = self._n
+        padded = np.zeros(len(self._L))
+        padded[:n] = b
+        solution = solve_triangular(
+            self._L,
+            padded,
+            lower=True,
+            trans=1 if transpose else 0,
+            check_finite=False,
+        )
+        return solution[:n]
+
+    def _update_alpha(self):
+        n = self._n
+        y = self._y[:n]
+
+        # Normalize training signals
+        self._y_train_mean = np.mean(y, axis=0)
+        self._y_train_std = np.std(y, axis=0)
+        if self._y_train_std == 0:
+            self._y_train_std = 1
+
+        self.X_train_ = self._X[:n]
+        self.y_train_ = (y - self._y_train_mean) / self._y_train_std
+        # A contiguous copy, since solve_triangular would copy the slice of
+        # the buffer on every prediction otherwise.
+        self.L_ = np.ascontiguousarray(self._L[:n, :n])
+
+        # Alg 2.1, page 19, line 3 -> alpha = L^T \ (L \ y), where L \ y for
+        # the normalized y is computed in O(n) from L^-1 y and L^-1 1.
+        z = (self._z_y[:n] - self._y_train_mean * self._z_1[:n]) / self._y_train_std
+        self.alpha_ = self._solve_lower(z, transpose=True)
+
+    def kernel_diagonal(self, X):
+        """The diagonal of self.kernel(X), without computing the rest."""
+        return np.ones(len(X))
+
+    def predict(self, X, return_std=False, chunk_size=1024, threads=1):
+        """Predict using the Gaussian process regression model.
+
+        Returns the mean and covariance of the prediction. With return_std,
+        returns the mean and standard deviation at each point instead, which
+        skips the covariance between different points: the query points are
+        processed chunk_size at a time, in up to `threads` threads, using
+        O(n_train * chunk_size) memory.
+        """
+        if return_std:
+            L = self.L_
+            return in_chunks(lambda c: self._predict_std(c, L), X, chunk_size, threads)
+
         # Alg 2.1, page 19, line 4 -> f*_bar = K(X_test, X_train) . alpha
         K_trans = self.kernel(X, self.X_train_)
         y_mean = K_trans @ self.alpha_
@@ -74,44 +217,334 @@ class GaussianProcessRegressor:
 
         return y_mean, y_cov
 
+    def _predict_std(self, X, L):
+        """The mean and standard deviation at X, as in predict."""
+        K_trans = self.kernel(X, self.X_train_)
+        y_mean = self._y_train_std * (K_trans @ self.alpha_) + self._y_train_mean
+        V = solve_triangular(L, K_trans.T, lower=True, check_finite=False)
+        # The diagonal of K(X_test, X_test) - v^T . v
+        y_var = self.kernel_diagonal(X) - np.einsum("ij,ij->j", V, V)
+        np.maximum(y_var, 0, out=y_var)
+        return y_mean, np.sqrt(y_var) * self._y_train_std
+
+
+class SparseGaussianProcessRegressor(GaussianProcessRegressor):
+    """A Gaussian process approximated through at most max_inducing points.
+
+    Uses the deterministic training conditional (DTC) approximation, in which
+    the observations X, y only enter through the sums A = K(Z, X) K(X, Z) and
+    b = K(Z, X) y over the m inducing points Z. Adding an observation costs
+    O(m^2), and predictions cost O(m^2) per point after an O(m^3)
+    factorization, however many observations there are.
+
+    An observation becomes an inducing point while there are fewer than
+    max_inducing of them and its variance given the inducing points is above
+    min_variance. When every observation is an inducing point, predictions
+    equal those of GaussianProcessRegressor with the same noise.
+    """
+
+    # The approximation needs more noise than the exact model to keep
+    # A + noise * K(Z, Z) well conditioned.
+    noise = 1e-6
+    jitter = 1e-10
+
+    def __init__(self, max_inducing=256, min_variance=1e-3):
+        self.max_inducing = max_inducing
+        self.min_variance = min_variance
+
+    def train(self, X, y):
+        self._n = 0
+        for x, target in zip(np.asarray(X, dtype=float), y):
+            self.add_observation(x, target)
+        return self
+
+    def add_observation(self, x, y):
+        x = np.asarray(x, dtype=float).reshape(1, -1)
+        n = len(self)
+        if n == 0:
+            self._X, self._y = np.zeros((1, x.shape[1])), np.zeros(1)
+            self._Z, self._L = np.zeros((0, x.shape[1])), np.zeros((0, 0))
+            self._A, self._b_y, self._b_1 = np.zeros((0, 0)), np.zeros(0), np.zeros(0)
+            # The number of observations before each inducing point was added.
+            self._added_after = []
+        if n == len(self._y):
+            self._X = np.concatenate([self._X, np.zeros_like(self._X)])
+            self._y = np.concatenate([self._y, np.zeros_like(self._y)])
+        self._X[n], self._y[n] = x[0], y
+        self._n = n + 1
+        self._factor = None
+
+        k = self.kernel(self._Z, x)[:, 0]
+        r = solve_triangular(self._L, k, lower=True, check_finite=False)
+        variance = self.kernel_diagonal(x)[0] - r @ r
+        self._A += np.outer(k, k)
+        self._b_y += k * y
+        self._b_1 += k
+        if len(self._Z) < self.max_inducing and variance > self.min_variance:
+            self._add_inducing(x, r, variance)
+        return self
+
+    def _add_inducing(self, z, r, variance, chunk_size=4096):
+        """Add z to Z, extending the Cholesky factor of K(Z, Z) by one row,
+        and add its row and column of A and entry of b by going over all
+        observations in chunks of chunk_size."""
+        m, n = len(self._Z), len(self)
+        L = np.zeros((m + 1, m + 1))
+        L[:m, :m] = self._L
+        L[m, :m] = r
+        L[m, m] = np.sqrt(variance + self.jitter)
+        self._L = L
+        self._Z = np.concatenate([self._Z, z])
+        self._added_after.append(n - 1)
+
+        row = np.zeros(m + 1)
+        b_y, b_1 = 0.0, 0.0
+        for start in range(0, n, chunk_size):
+            K = self.kernel(self._X[start : min(n, start + chunk_size)], self._Z)
+            row += K.T @ K[:, m]
+            b_y += K[:, m] @ self._y[start : min(n, start + chunk_size)]
+            b_1 += K[:, m].sum()
+        A = np.zeros((m + 1, m + 1))
+        A[:m, :m] = self._A
+        A[m, :] = A[:, m] = row
+        self._A = A
+        self._b_y = np.append(self._b_y, b_y)
+        self._b_1 = np.append(self._b_1, b_1)
+
+    def truncate(self, n):
+        """Forget all but the first n observations, and the inducing points
+        they added, by subtracting their terms from the sums."""
+        old_n = len(self)
+        if n >= old_n:
+            return self
+        m = sum(1 for added_after in self._added_after if added_after < n)
+        self._Z, self._L = self._Z[:m], self._L[:m, :m]
+        self._A, self._b_y, self._b_1 = self._A[:m, :m], self._b_y[:m], self._b_1[:m]
+        del self._added_after[m:]
+        K = self.kernel(self._Z, self._X[n:old_n])
+        self._A -= K @ K.T
+        self._b_y -= K @ self._y[n:old_n]
+        self._b_1 -= K.sum(axis=1)
+        self._n = n
+        self._factor = None
+        return self
+
+    @property
+    def inducing_points(self):
+        return self._Z
+
+    def _factorize(self):
+        """The Cholesky factor C of A + noise * K(Z, Z), the weights
+        C^-T C^-1 b of the normalized b, and the normalization of y."""
+        if self._factor is None:
+            y = self._y[: len(self)]
+            y_mean, y_std = np.mean(y), np.std(y)
+            y_std = y_std if y_std != 0 else 1
+            C = cholesky(self._A + self.noise * self._L @ self._L.T, lower=True)
+            b = (self._b_y - y_mean * self._b_1) / y_std
+            self._factor = C, cho_solve((C, True), b), y_mean, y_std
+        return self._factor
+
+    def predict(self, X, return_std=False, chunk_size=1024, threads=1):
+        """Predict as GaussianProcessRegressor.predict does, with DTC."""
+        if return_std:
+            factor = self._factorize()
+            return in_chunks(
+                lambda c: self._predict_std(c, factor),
+                X,
+                chunk_size,
+                threads,
+            )
+        C, weights, y_mean, y_std = self._factorize()
+        K_trans = self.kernel(X, self._Z)
+        V = solve_triangular(self._L, K_trans.T, lower=True, check_finite=False)
+        W = solve_triangular(C, K_trans.T, lower=True, check_finite=False)
+        y_cov = self.kernel(X) - V.T @ V + self.noise * W.T @ W
+        return y_std * (K_trans @ weights) + y_mean, y_cov * y_std**2
+
+    def _predict_std(self, X, factor):
+        C, weights, y_mean, y_std = factor
+        K_trans = self.kernel(X, self._Z)
+        V = solve_triangular(self._L, K_trans.T, lower=True, check_finite=False)
+        W = solve_triangular(C, K_trans.T, lower=True, check_finite=False)
+        # k(x, x) - Q(x, x) + noise * k(x, Z) (A + noise * K(Z, Z))^-1 k(Z, x)
+        y_var = (
+            self.kernel_diagonal(X)
+            - np.einsum("ij,ij->j", V, V)
+            + self.noise * np.einsum("ij,ij->j", W, W)
+        )
+        np.maximum(y_var, 0, out=y_var)
+        return y_std * (K_trans @ weights) + y_mean, np.sqrt(y_var) * y_std
+
+
+class Grid:
+    """The product of one list of values per feature, indexed implicitly.
+
+    Point i of the grid is the i-th element of itertools.product(*features),
+    but points are only computed for the indices that are asked for.
+    """
+
+    def __init__(self, features):
+        self.features = features
+        self.values = [np.asarray(f, dtype=float) for f in features]
+        self.shape = tuple(len(f) for f in features)
+        self.size = int(np.prod(self.shape, dtype=np.int64))
+
+    def points(self, indices):
+        """The points with the given flat indices, as rows of an array."""
+        coordinates = np.unravel_index(indices, self.shape)
+        return np.column_stack([v[c] for (v, c) in zip(self.values, coordinates)])
+
+    def point(self, index):
+        """The point with the given flat index, with the original values."""
+        coordinates = np.unravel_index(index, self.shape)
+        return tuple(f[c] for (f, c) in zip(self.features, coordinates))
+
+    def neighbors(self, index):
+        """The indices of the points one step away along a single feature."""
+        coordinates = np.array(np.unravel_index(index, self.shape))
+        steps = np.concatenate([np.eye(len(self.shape)), -np.eye(len(self.shape))])
+        moved = coordinates + steps.astype(np.int64)
+        inside = ((moved >= 0) & (moved < self.shape)).all(axis=1)
+        return np.ravel_multi_index(tuple(moved[inside].T), self.shape)
+
 
 class GpUcb:
-    def __init__(self, input_spaces, beta=10):
-        """Initalize the GP UCB algorithm."""
-        self.beta = beta
+    def __init__(
+        self,
+        input_spaces,
+        beta=10,
+        batch_size=4096,
+        local_search_starts=8,
+        seed=0,
+        gp=None,
+    ):
+        """Initalize the GP UCB algorithm.
 
-        # Flatten the input space so it can be indexed by a single integer.
-        # A smarter approach would use an implicit indexing scheme.
+        The input space is the grid of all combinations of the values in
+        input_spaces. Grids of up to batch_size points are searched
+        exhaustively for the point maximizing the upper confidence bound.
+        Larger grids are searched by scoring batch_size random points and
+        hill-climbing from the best local_search_starts of them (and the best
+        observed points), so memory use does not depend on the grid size.
+
+        gp is the regressor to fit, an exact GaussianProcessRegressor by
+        default. For long runs, pass a SparseGaussianProcessRegressor to keep
+        the cost of each step bounded.
+        """
+        self.beta = beta
         self.features = input_spaces
-        self.input_space = list(itertools.product(*input_spaces))
+        self.grid = Grid(input_spaces)
+        self.batch_size = batch_size
+        self.local_search_starts = local_search_starts
+        self.rng = np.random.default_rng(seed)
 
         # Initial mean/stdev values are chosen arbitrarily here,
         # but in Vizier, input parameters have a variety of allowed
         # configurations that impact the initial values. See
         # https://github.com/google/vizier/blob/3e2581814f219a29c2e540c3df8d8a5c911d55ce/vizier/_src/pyvizier/shared/parameter_config.py#L238
-        self.mean = np.array([0] * len(self.input_space))
-        self.stdev = np.array([0.5] * len(self.input_space))
+        self.prior_mean = 0.0
+        self.prior_stdev = 0.5
 
+        self.obs_indices = []
         self.obs_inputs = []
         self.obs_outputs = []
+        self.gp = GaussianProcessRegressor() if gp is None else gp
+
+        # Grid indices of suggestions from suggest_batch awaiting results,
+        # by trial id.
+        self.pending = {}
+        self.next_trial = 0
+        # The trial id of the last suggest, which update completes.
+        self.suggested_trial = None
+
+    def estimates(self, indices):
+        """The posterior mean and standard deviation at the given grid indices."""
+        if len(self.gp) == 0:
+            return (
+                np.full(len(indices), self.prior_mean),
+                np.full(len(indices), self.prior_stdev),
+            )
+        return self.gp.predict(self.grid.points(indices), return_std=True)
+
+    def acquisition(self, indices):
+        mean, stdev = self.estimates(indices)
+        return mean + stdev * self.beta**0.5
+
+    def maximize_acquisition(self):
+        if self.grid.size <= self.batch_size:
+            return int(np.argmax(self.acquisition(np.arange(self.grid.size))))
+
+        candidates = np.concatenate(
+            [
+                self.rng.integers(0, self.grid.size, self.batch_size),
+                np.array(self.obs_indices, dtype=np.int64),
+            ],
+        )
+        values = self.acquisition(candidates)
+        top = np.argsort(-values)[: self.local_search_starts]
+        best_index, best_value = int(candidates[top[0]]), values[top[0]]
+        for index, value in zip(candidates[top], values[top]):
+            while True:
+                neighbors = self.grid.neighbors(index)
+                neighbor_values = self.acquisition(neighbors)
+                if neighbor_values.max() <= value:
+                    break
+                index = neighbors[np.argmax(neighbor_values)]
+                value = neighbor_values.max()
+            if value > best_value:
+                best_index, best_value = int(index), value
+        return best_index
 
     def suggest(self):
-        index = np.argmax(self.mean + self.stdev * self.beta**0.5)
-        suggestion = self.input_space[index]
-        self.obs_inputs.append(suggestion)
+        """Suggest one point, like suggest_batch(1), to be reported with update."""
+        [(self.suggested_trial, suggestion)] = self.suggest_batch(1)
         return suggestion
 
     def update(self, observed_output):
+        self.complete(self.suggested_trial, observed_output)
+        self.suggested_trial = None
+
+    def suggest_batch(self, k):
+        """Suggest k points to evaluate in parallel, as (trial id, point) pairs.
+
+        Uses the kriging believer heuristic: each chosen point, and each point
+        still pending from earlier batches, is temporarily added to the GP as
+        if its result were the predicted mean. That collapses the uncertainty
+        around it, so the next point is chosen elsewhere. Each fantasy is an
+        O(n^2) add_observation, and all are dropped again before returning.
+        Report results with complete, in any order.
+        """
+        num_observations = len(self.gp)
+        for index in self.pending.values():
+            self._fantasize(index)
+        trials = []
+        for _ in range(k):
+            index = self.maximize_acquisition()
+            trial, self.next_trial = self.next_trial, self.next_trial + 1
+            self.pending[trial] = index
+            trials.append((trial, self.grid.point(index)))
+            self._fantasize(index)
+        self.gp.truncate(num_observations)
+        return trials
+
+    def _fantasize(self, index):
+        mean, _ = self.estimates([index])
+        self.gp.add_observation(self.grid.points([index])[0], mean[0])
+
+    def complete(self, trial, observed_output):
+        """Record the result of a trial from suggest_batch."""
+        index = self.pending.pop(trial)
+        self.obs_indices.append(index)
+        self.obs_inputs.append(self.grid.point(index))
         self.obs_outputs.append(observed_output)
-        gp = GaussianProcessRegressor()
-        gp.train(self.obs_inputs, self.obs_outputs)
-        self.mean, cov = gp.predict(self.input_space)
-        self.stdev = cov.diagonal() ** 0.5
+        self.gp.add_observation(self.obs_inputs[-1], observed_output)
 
     def unwind_estimates(self):
+        """Map every point of the grid to its (mean, stdev). Only for small grids."""
         output = dict()
-        indices = itertools.product(*[range(len(x)) for x in self.features])
-        for flat_index, index_tuple in enumerate(indices):
-            input = tuple(f[i] for (f, i) in zip(self.features, index_tuple))
-            output[input] = (self.mean[flat_index], self.stdev[flat_index])
+        for start in range(0, self.grid.size, self.batch_size):
+            indices = np.arange(start, min(start + self.batch_size, self.grid.size))
+            for index, mean, stdev in zip(indices, *self.estimates(indices)):
+                output[self.grid.point(index)] = (mean, stdev)
         return output
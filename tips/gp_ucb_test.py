@@ -1,6 +1,13 @@
+import itertools
+
 import numpy as np
 
-from tips.gp_ucb import GaussianProcessRegressor, GpUcb
+from tips.gp_ucb import (
+    GaussianProcessRegressor,
+    GpUcb,
+    Grid,
+    SparseGaussianProcessRegressor,
+)
 
 TRAIN_X = np.array(
     [
@@ -63,3 +70,215 @@ def test_sin_plus_cos():
 
     print("estimated max input")
     print(max(estimates, key=lambda x: estimates[x][0]))
+
+
+def test_add_observation_matches_train():
+    rng = np.random.default_rng(0)
+    X = rng.uniform(0, 3, (40, 3))
+    y = np.sin(X).sum(axis=1)
+
+    incremental = GaussianProcessRegressor()
+    for x, target in zip(X, y):
+        incremental.add_observation(x, target)
+    trained = GaussianProcessRegressor().train(X, y)
+
+    np.testing.assert_allclose(incremental.L_, trained.L_, atol=1e-8)
+    np.testing.assert_allclose(incremental.alpha_, trained.alpha_, rtol=1e-6)
+    test_X = rng.uniform(0, 3, (10, 3))
+    for actual, expected in zip(incremental.predict(test_X), trained.predict(test_X)):
+        np.testing.assert_allclose(actual, expected, atol=1e-8)
+
+
+def test_predict_std_matches_covariance_diagonal():
+    gp = GaussianProcessRegressor().train(TRAIN_X, TRAIN_Y)
+    test_X = np.random.default_rng(1).uniform(0, 1, (20, 5))
+    mean, cov = gp.predict(test_X)
+    std_mean, std = gp.predict(test_X, return_std=True)
+    np.testing.assert_allclose(std_mean, mean)
+    np.testing.assert_allclose(std, np.sqrt(np.maximum(cov.diagonal(), 0)), atol=1e-8)
+
+
+def test_grid_matches_product():
+    features = [[1, 2, 3], [10, 20], [0.5, 1.5, 2.5, 3.5]]
+    grid = Grid(features)
+    expected = list(itertools.product(*features))
+
+    assert grid.size == len(expected)
+    assert [grid.point(i) for i in range(grid.size)] == expected
+    np.testing.assert_array_equal(grid.points(np.arange(grid.size)), expected)
+
+    neighbors = {grid.point(i) for i in grid.neighbors(expected.index((2, 10, 3.5)))}
+    assert neighbors == {(1, 10, 3.5), (3, 10, 3.5), (2, 20, 3.5), (2, 10, 2.5)}
+
+
+def test_gp_ucb_on_huge_grid():
+    # 20^8 points, far too many to materialize
+    features = [np.linspace(-2, 2, 20)] * 8
+
+    def f(x):
+        return -np.sum((np.array(x) - 0.5) ** 2)
+
+    gp_ucb = GpUcb(input_spaces=features, batch_size=512)
+    outputs = []
+    for _ in range(15):
+        outputs.append(f(gp_ucb.suggest()))
+        gp_ucb.update(outputs[-1])
+
+    assert gp_ucb.grid.size == 20**8
+    optimum = f(features[0][np.argmin(np.abs(features[0] - 0.5))] * np.ones(8))
+    assert max(outputs) > optimum - 1.0
+
+    # random search with the same budget does much worse
+    rng = np.random.default_rng(0)
+    random_outputs = [f(rng.choice(features[0], 8)) for _ in range(15)]
+    assert max(outputs) > max(random_outputs) + 1.0
+
+
+def test_predict_std_in_chunks_and_threads():
+    rng = np.random.default_rng(2)
+    X = rng.uniform(0, 3, (50, 2))
+    gp = GaussianProcessRegressor().train(X, np.cos(X).sum(axis=1))
+    test_X = rng.uniform(0, 3, (100, 2))
+
+    expected = gp.predict(test_X, return_std=True)
+    actual = gp.predict(test_X, return_std=True, chunk_size=7, threads=3)
+
+    for a, e in zip(actual, expected):
+        np.testing.assert_allclose(a, e, atol=1e-8)
+    assert [len(a) for a in gp.predict(test_X[:0], return_std=True)] == [0, 0]
+
+
+def test_suggest_batch_spreads_out_and_restores_the_gp():
+    features = [np.linspace(0, np.pi, 7)] * 2
+    gp_ucb = GpUcb(input_spaces=features)
+    for _ in range(3):
+        gp_ucb.update(np.sin(gp_ucb.suggest()).sum())
+    indices = np.arange(gp_ucb.grid.size)
+    before = gp_ucb.estimates(indices)
+
+    trials = gp_ucb.suggest_batch(5)
+
+    assert len({point for (_, point) in trials}) == 5
+    assert len({trial for (trial, _) in trials}) == 5
+    assert len(gp_ucb.gp) == 3
+    for a, e in zip(gp_ucb.estimates(indices), before):
+        np.testing.assert_allclose(a, e, atol=1e-8)
+
+    # Pending trials are avoided by the next batch, too.
+    later = gp_ucb.suggest_batch(3)
+    assert not {p for (_, p) in later} & {p for (_, p) in trials}
+
+
+def test_complete_out_of_order_matches_train():
+    features = [np.linspace(0, 3, 6)] * 3
+    gp_ucb = GpUcb(input_spaces=features)
+
+    def f(x):
+        return float(np.cos(x).sum())
+
+    trials = gp_ucb.suggest_batch(4) + gp_ucb.suggest_batch(4)
+    for trial, point in reversed(trials[:6]):
+        gp_ucb.complete(trial, f(point))
+    assert sorted(gp_ucb.pending) == [trials[6][0], trials[7][0]]
+    trials = gp_ucb.suggest_batch(2)
+    for trial, point in trials:
+        gp_ucb.complete(trial, f(point))
+
+    X = np.array(gp_ucb.obs_inputs)
+    trained = GaussianProcessRegressor().train(X, gp_ucb.obs_outputs)
+    test_X = gp_ucb.grid.points(np.arange(gp_ucb.grid.size))
+    actual = gp_ucb.gp.predict(test_X, return_std=True)
+    expected = trained.predict(test_X, return_std=True)
+    for a, e in zip(actual, expected):
+        np.testing.assert_allclose(a, e, atol=1e-6)
+
+
+def test_suggest_and_update_interleaved_with_batches():
+    features = [np.linspace(0, 3, 6)] * 3
+    gp_ucb = GpUcb(input_spaces=features)
+
+    def f(x):
+        return float(np.cos(x).sum())
+
+    trials = gp_ucb.suggest_batch(3)
+    point = gp_ucb.suggest()
+    # suggest avoids the pending trials, as suggest_batch does.
+    assert point not in {p for (_, p) in trials}
+
+    # A completed trial between suggest and update doesn't steal its result.
+    gp_ucb.complete(trials[0][0], f(trials[0][1]))
+    gp_ucb.update(f(point))
+    later = gp_ucb.suggest_batch(2)
+    assert point not in {p for (_, p) in later}
+    for trial, p in trials[1:] + later:
+        gp_ucb.complete(trial, f(p))
+
+    assert not gp_ucb.pending
+    assert len(gp_ucb.obs_inputs) == len(gp_ucb.gp) == 6
+    for x, y in zip(gp_ucb.obs_inputs, gp_ucb.obs_outputs):
+        assert y == f(x)
+    X = np.array(gp_ucb.obs_inputs)
+    trained = GaussianProcessRegressor().train(X, gp_ucb.obs_outputs)
+    np.testing.assert_allclose(gp_ucb.gp.L_, trained.L_, atol=1e-8)
+
+
+def test_sparse_gp_with_all_points_inducing_matches_exact():
+    rng = np.random.default_rng(3)
+    # Few, spread out points, as A = K(X, Z) K(Z, X) squares the condition
+    # number of the kernel matrix.
+    X = rng.uniform(0, 6, (15, 2))
+    y = np.sin(X).sum(axis=1)
+    sparse = SparseGaussianProcessRegressor(max_inducing=100, min_variance=0)
+    sparse.train(X, y)
+    exact = GaussianProcessRegressor()
+    exact.noise = sparse.noise
+    exact.train(X, y)
+    test_X = rng.uniform(0, 6, (40, 2))
+
+    assert len(sparse.inducing_points) == 15
+    for return_std in [False, True]:
+        actual = sparse.predict(test_X, return_std=return_std)
+        expected = exact.predict(test_X, return_std=return_std)
+        for a, e in zip(actual, expected):
+            np.testing.assert_allclose(a, e, atol=1e-5)
+
+
+def test_sparse_gp_bounds_inducing_points():
+    rng = np.random.default_rng(4)
+    X = rng.uniform(0, 3, (3000, 2))
+    y = np.sin(X).sum(axis=1) + rng.normal(0, 0.01, len(X))
+    sparse = SparseGaussianProcessRegressor(max_inducing=40)
+    for x, target in zip(X, y):
+        sparse.add_observation(x, target)
+
+    assert len(sparse) == 3000
+    assert len(sparse.inducing_points) <= 40
+    test_X = rng.uniform(0, 3, (200, 2))
+    mean, std = sparse.predict(test_X, return_std=True)
+    np.testing.assert_allclose(mean, np.sin(test_X).sum(axis=1), atol=0.05)
+    assert std.max() < 0.1
+
+    # Truncating undoes the last observations, including inducing points.
+    before = sparse.predict(test_X, return_std=True)
+    for x in rng.uniform(3, 6, (5, 2)):
+        sparse.add_observation(x, 0.0)
+    sparse.truncate(3000)
+    for a, e in zip(sparse.predict(test_X, return_std=True), before):
+        np.testing.assert_allclose(a, e, atol=1e-6)
+
+
+def test_gp_ucb_with_sparse_gp():
+    feature = np.linspace(0, np.pi, 9)
+    gp_ucb = GpUcb(
+        input_spaces=[feature, feature],
+        gp=SparseGaussianProcessRegressor(max_inducing=20),
+    )
+    outputs = []
+    for _ in range(30):
+        outputs.append(np.sin(gp_ucb.suggest()).sum())
+        gp_ucb.update(outputs[-1])
+    for trial, point in gp_ucb.suggest_batch(4):
+        gp_ucb.complete(trial, np.sin(point).sum())
+
+    assert len(gp_ucb.gp.inducing_points) <= 20
+    assert max(outputs) > 1.9
@@ -0,0 +1,87 @@
+import numpy as np
+from hypothesis import given, settings
+from hypothesis.strategies import integers
+
+from tips.linucb import LinUCB, SharedLinUCB
+
+
+@settings(deadline=None, max_examples=20)
+@given(integers(min_value=0, max_value=10000))
+def test_sherman_morrison_matches_ridge_regression(seed):
+    rng = np.random.default_rng(seed)
+    num_arms, dim = 4, 6
+    bandit = LinUCB.create(num_arms, dim, regularization=2.0)
+    arms = rng.integers(0, num_arms, 100)
+    contexts = rng.normal(0, 1, (100, dim))
+    rewards = rng.normal(0, 1, 100)
+    for arm, context, reward in zip(arms, contexts, rewards):
+        bandit.update(arm, context, reward)
+
+    for arm in range(num_arms):
+        X, r = contexts[arms == arm], rewards[arms == arm]
+        A = 2.0 * np.eye(dim) + X.T @ X
+        np.testing.assert_allclose(bandit.A_inv[:, arm], np.linalg.inv(A), atol=1e-10)
+        np.testing.assert_allclose(bandit.theta[arm], np.linalg.solve(A, X.T @ r))
+
+
+def test_scores_match_per_arm_formula():
+    rng = np.random.default_rng(1)
+    bandit = LinUCB.create(num_arms=7, dim=5, alpha=0.5)
+    for _ in range(50):
+        bandit.update(rng.integers(0, 7), rng.normal(0, 1, 5), rng.normal())
+    contexts = rng.normal(0, 1, (10, 5))
+
+    scores = bandit.scores(contexts, chunk_size=3)
+
+    for i, x in enumerate(contexts):
+        for arm in range(7):
+            expected = bandit.theta[arm] @ x + 0.5 * np.sqrt(
+                x @ bandit.A_inv[:, arm] @ x,
+            )
+            assert np.isclose(scores[i, arm], expected)
+
+
+def random_unit_thetas(rng, num_arms, dim):
+    true_theta = rng.normal(0, 1, (num_arms, dim))
+    true_theta /= np.linalg.norm(true_theta, axis=1, keepdims=True)
+    return true_theta
+
+
+def test_lin_ucb_learns_best_arm_per_context():
+    rng = np.random.default_rng(2)
+    num_arms, dim = 5, 4
+    true_theta = random_unit_thetas(rng, num_arms, dim)
+    bandit = LinUCB.create(num_arms, dim, alpha=0.5)
+
+    correct = []
+    for _ in range(100):
+        contexts = rng.normal(0, 1, (20, dim))
+        arms = bandit.select(contexts)
+        correct.extend(arms == np.argmax(contexts @ true_theta.T, axis=1))
+        for arm, x in zip(arms, contexts):
+            bandit.update(arm, x, true_theta[arm] @ x + rng.normal(0, 0.1))
+
+    assert np.mean(correct[-400:]) > 0.9
+
+
+def test_shared_lin_ucb_learns_best_arm():
+    rng = np.random.default_rng(3)
+    num_arms, dim = 10, 6
+    true_theta = random_unit_thetas(rng, 1, dim)[0]
+    bandit = SharedLinUCB.create(dim, alpha=0.5)
+
+    correct = []
+    for _ in range(50):
+        contexts = rng.normal(0, 1, (20, num_arms, dim))
+        arms = bandit.select(contexts)
+        correct.extend(arms == np.argmax(contexts @ true_theta, axis=1))
+        for arm, x in zip(arms, contexts):
+            bandit.update(x[arm], true_theta @ x[arm] + rng.normal(0, 0.1))
+
+    assert np.mean(correct[-400:]) > 0.9
+    X = rng.normal(0, 1, (2, 3, dim))
+    widths = np.array([[x @ bandit.A_inv @ x for x in row] for row in X])
+    np.testing.assert_allclose(
+        bandit.scores(X),
+        X @ bandit.theta + 0.5 * np.sqrt(widths),
+    )
@@ -0,0 +1,218 @@
+"""Matchmaking: find opponents with a predicted win probability close to 1/2.
+
+Players are indexed by their TrueSkill ratings, grouped into buckets of
+similar rating variance, and sorted by mean within each bucket. Because the
+predicted win probability of a match depends on the difference of means scaled
+by the combined variance, the variance bucket gives a bound on how good any
+not-yet-examined opponent in that bucket can be, and a best-first search over
+the buckets can stop as soon as no bucket can beat the opponents found so far.
+"""
+
+import heapq
+from bisect import bisect_left
+from math import sqrt
+from typing import Dict, Iterable, List, Optional, Tuple
+
+import numpy as np
+
+from tips.skill_ranking import standard_normal_cumulative_density
+from tips.skill_ranking_teams import SKILL_CLASS_WIDTH, Player, RatingTable
+
+
+def find(parent: List[int], i: int) -> int:
+    """Union-find lookup with path compression."""
+    root = i
+    while parent[root] != root:
+        root = parent[root]
+    while parent[i] != root:
+        parent[i], i = root, parent[i]
+    return root
+
+
+class Bucket:
+    """Players with similar rating variance, sorted by mean.
+
+    Removed players are skipped by following union-find pointers: right[i] leads
+    to the closest available position at or after i, and left[i + 1] leads
+    to the closest available position at or before i, plus one. The last entry
+    of `right` and the first entry of `left` are sentinels for "no player".
+    """
+
+    def __init__(self, players: np.ndarray, means: np.ndarray, stddevs: np.ndarray):
+        order = np.argsort(means, kind="stable")
+        self.players: List[int] = players[order].tolist()
+        self.means: List[float] = means[order].tolist()
+        self.variances: List[float] = (stddevs[order] ** 2).tolist()
+        self.max_variance = max(self.variances)
+        self.right = list(range(len(self.players) + 1))
+        self.left = list(range(len(self.players) + 1))
+
+    def remove(self, position: int) -> None:
+        self.right[position] = position + 1
+        self.left[position + 1] = position
+
+    def next_available(self, position: int, direction: int) -> Optional[int]:
+        if direction > 0:
+            position = find(self.right, position)
+            return position if position < len(self.players) else None
+        position = find(self.left, position + 1) - 1
+        return position if position >= 0 else None
+
+
+class MatchmakingIndex:
+    def __init__(self, table: RatingTable, players: Iterable[Player], num_buckets=16):
+        """Index the given (queued) players by their ratings in `table`."""
+        players = np.asarray(list(players), dtype=int)
+        means, stddevs = table.means[players], table.stddevs[players]
+        edges = np.quantile(stddevs, np.linspace(0, 1, num_buckets + 1)[1:-1])
+        bucket_of = np.searchsorted(edges, stddevs, side="right")
+
+        self.buckets: List[Bucket] = []
+        self.location: Dict[int, Tuple[int, int]] = dict()
+        for b in np.unique(bucket_of):
+            in_bucket = bucket_of == b
+            bucket = Bucket(players[in_bucket], means[in_bucket], stddevs[in_bucket])
+            for position, player in enumerate(bucket.players):
+                self.location[player] = (len(self.buckets), position)
+            self.buckets.append(bucket)
+
+        self.table = table
+
+    def remove(self, player: Player) -> None:
+        """Remove a player from the index, e.g., once they are matched."""
+        b, position = self.location.pop(player)
+        self.buckets[b].remove(position)
+
+    def __contains__(self, player: Player) -> bool:
+        return player in self.location
+
+    def nearest(
+        self,
+        mean: float,
+        variance: float,
+        k: int = 1,
+    ) -> List[Tuple[Player, float]]:
+        """Find the k indexed players giving the most even match.
+
+        The querying side is described by the sum of its players' means, and
+        the sum of its players' variances plus SKILL_CLASS_WIDTH per player, so
+        that a team can look for a single opponent as well.
+
+        Returns a list of (player, win probability of the querying side),
+        ordered from the most to the least even match.
+        """
+        # Each frontier entry is (lower bound on |z|, bucket, direction, position),
+        # where z is the normalized mean difference and the win probability is
+        # normal_cdf(z). Within a bucket, |z| is at least the mean difference
+        # scaled by the bucket's largest variance, and grows as the search
+        # moves away from `mean` in either direction.
+        frontier: List[Tuple[float, int, int, int]] = []
+        scales: List[float] = []
+
+        def push(b, direction, position):
+            if position is not None:
+                bound = abs(self.buckets[b].means[position] - mean) * scales[b]
+                heapq.heappush(frontier, (bound, b, direction, position))
+
+        for b, bucket in enumerate(self.buckets):
+            scales.append(1 / sqrt(variance + bucket.max_variance + SKILL_CLASS_WIDTH))
+            start = bisect_left(bucket.means, mean)
+            if start < len(bucket.players):
+                push(b, 1, bucket.next_available(start, 1))
+            if start > 0:
+                push(b, -1, bucket.next_available(start - 1, -1))
+
+        # A max-heap (by negated |z|) of the best k players found so far
+        best: List[Tuple[float, float, int]] = []
+        while frontier and (len(best) < k or frontier[0][0] < -best[0][0]):
+            _, b, direction, position = heapq.heappop(frontier)
+            bucket = self.buckets[b]
+            diff = mean - bucket.means[position]
+            z = diff / sqrt(variance + bucket.variances[position] + SKILL_CLASS_WIDTH)
+            entry = (-abs(z), z, bucket.players[position])
+            if len(best) < k:
+                heapq.heappush(best, entry)
+            else:
+                heapq.heappushpop(best, entry)
+            push(b, direction, bucket.next_available(position + direction, direction))
+
+        return [
+            (Player(player), standard_normal_cumulative_density(z))
+            for (_, z, player) in sorted(best, reverse=True)
+        ]
+
+    def nearest_opponents(
+        self,
+        player: Player,
+        k: int = 1,
+    ) -> List[Tuple[Player, float]]:
+        """Find the best k opponents for a player, who need not be indexed."""
+        mean = self.table.means[player]
+        variance = self.table.stddevs[player] ** 2 + SKILL_CLASS_WIDTH
+        # Ask for one extra in case the player finds themselves.
+        found = [
+            (p, q) for (p, q) in self.nearest(mean, variance, k + 1) if p != player
+        ]
+        return found[:k]
+
+
+def match_queue(
+    table: RatingTable,
+    queue: Iterable[Player],
+    num_buckets: int = 16,
+) -> List[Tuple[Player, Player, float]]:
+    """Pair up all queued players into one-on-one matches.
+
+    Players are matched greedily in queue order, each with the most even
+    opponent still waiting. Returns a list of (player, opponent, win
+    probability of player). If the queue has an odd size, the last
+    unmatched player is left out.
+    """
+    queue = list(queue)
+    index = MatchmakingIndex(table, queue, num_buckets=num_buckets)
+    matches = []
+    for player in queue:
+        if player not in index:
+            continue
+        index.remove(player)
+        found = index.nearest_opponents(player)
+        if not found:
+            break
+        opponent, probability = found[0]
+        index.remove(opponent)
+        matches.append((player, opponent, probability))
+    return matches
+
+
+if __name__ == "__main__":  # pragma: no cover
+    import time
+
+    num_players = 100_000
+    rng = np.random.default_rng(1)
+    table = RatingTable(
+        means=rng.normal(25, 8, num_players),
+        stddevs=rng.uniform(0.5, 8.3, num_players),
+    )
+    queue = [Player(int(p)) for p in rng.permutation(num_players)]
+
+    start = time.perf_counter()
+    index = MatchmakingIndex(table, queue)
+    print(f"index {num_players} queued players: {time.perf_counter() - start:.3f}s")
+
+    num_queries = 10_000
+    latencies = []
+    for player in queue[:num_queries]:
+        start = time.perf_counter()
+        index.nearest_opponents(player, k=10)
+        latencies.append(time.perf_counter() - start)
+    p50, p99 = np.percentile(latencies, [50, 99]) * 1e6
+    print(f"10-nearest opponents: p50={p50:.0f}us, p99={p99:.0f}us")
+
+    start = time.perf_counter()
+    matches = match_queue(table, queue)
+    elapsed = time.perf_counter() - start
+    unevenness = np.mean([abs(p - 0.5) for (_, _, p) in matches])
+    print(
+        f"matched {len(matches)} pairs in {elapsed:.3f}s, "
+        f"mean |win probability - 0.5| = {unevenness:.4f}",
+    )
@@ -0,0 +1,79 @@
+import numpy as np
+from hypothesis import given, settings
+from hypothesis.strategies import integers
+
+from tips.matchmaking import MatchmakingIndex, match_queue
+from tips.skill_ranking import standard_normal_cumulative_density
+from tips.skill_ranking_teams import SKILL_CLASS_WIDTH, Player, RatingTable
+
+
+def random_table(num_players, seed):
+    rng = np.random.default_rng(seed)
+    return RatingTable(
+        means=rng.normal(25, 8, num_players),
+        stddevs=rng.uniform(0.5, 8.3, num_players),
+    )
+
+
+def brute_force_win_probabilities(table, player, candidates):
+    probabilities = dict()
+    for opponent in candidates:
+        if opponent == player:
+            continue
+        diff = table.means[player] - table.means[opponent]
+        variance = (
+            table.stddevs[player] ** 2
+            + table.stddevs[opponent] ** 2
+            + 2 * SKILL_CLASS_WIDTH
+        )
+        probabilities[opponent] = standard_normal_cumulative_density(
+            diff / variance**0.5,
+        )
+    return probabilities
+
+
+@settings(deadline=None, max_examples=20)
+@given(integers(min_value=0, max_value=1000), integers(min_value=1, max_value=10))
+def test_nearest_opponents_matches_brute_force(seed, k):
+    table = random_table(500, seed)
+    players = [Player(p) for p in range(500)]
+    index = MatchmakingIndex(table, players, num_buckets=8)
+
+    removed = players[::3]
+    for player in removed:
+        index.remove(player)
+    remaining = [p for p in players if p not in removed]
+
+    for player in players[:20]:
+        expected = brute_force_win_probabilities(table, player, remaining)
+        expected_unevenness = sorted(abs(p - 0.5) for p in expected.values())[:k]
+
+        actual = index.nearest_opponents(player, k=k)
+
+        assert len(actual) == k
+        for opponent, probability in actual:
+            assert opponent in expected
+            assert abs(expected[opponent] - probability) < 1e-12
+        actual_unevenness = [abs(p - 0.5) for (_, p) in actual]
+        np.testing.assert_allclose(actual_unevenness, expected_unevenness)
+
+
+def test_match_queue_pairs_everyone_once():
+    table = random_table(1001, seed=1)
+    queue = [Player(p) for p in range(1001)]
+
+    matches = match_queue(table, queue)
+
+    matched = [p for (p1, p2, _) in matches for p in (p1, p2)]
+    assert len(matches) == 500
+    assert len(set(matched)) == 1000
+
+    # Compare with pairing players in queue order
+    unevenness = np.mean([abs(p - 0.5) for (_, _, p) in matches])
+    naive_unevenness = np.mean(
+        [
+            abs(brute_force_win_probabilities(table, p1, [p2])[p2] - 0.5)
+            for (p1, p2) in zip(queue[::2], queue[1::2])
+        ],
+    )
+    assert unevenness < naive_unevenness / 10
@@ -1,4 +1,7 @@
-from dataclasses import dataclass
+from dataclasses import dataclass, field, fields
+from typing import List, Union
+
+import numpy as np
 
 
 def clamp(n, smallest, largest):
@@ -17,7 +20,8 @@ class PrincipalIntegralDerviativeController:
     output_max: float = 1.0
     # One could also set a constant dt and ensure the PID is called in regular
     # intervals. This would be useful for avoiding extra multiplications and
-    # divisions when running on a microcontroller.
+    # divisions when running on a microcontroller. See FixedRatePIDController
+    # and FixedPointPIDController.
 
     def run(self, measurement: float, dt: float) -> float:
         error = self.setpoint - measurement
@@ -42,6 +46,220 @@ class PrincipalIntegralDerviativeController:
         return clamp(output, self.output_min, self.output_max)
 
 
+@dataclass
+class PIDBank:
+    """Many independent PID controllers, stored as one array per field.
+
+    run advances all controllers by one tick with a few vectorized operations,
+    with the same results as calling PrincipalIntegralDerviativeController.run
+    on each controller. Gains, setpoints and clamps can be changed between
+    ticks by writing into the arrays.
+    """
+
+    kp: np.ndarray
+    ki: np.ndarray
+    kd: np.ndarray
+    setpoint: np.ndarray
+    last_measurement: np.ndarray
+    integral: np.ndarray
+    output_min: np.ndarray
+    output_max: np.ndarray
+
+    @staticmethod
+    def create(
+        num_controllers: int,
+        kp: Union[float, np.ndarray],
+        ki: Union[float, np.ndarray],
+        kd: Union[float, np.ndarray],
+        setpoint: Union[float, np.ndarray],
+        output_min: Union[float, np.ndarray] = -1.0,
+        output_max: Union[float, np.ndarray] = 1.0,
+    ) -> "PIDBank":
+        """Create fresh controllers, broadcasting scalar parameters to all."""
+
+        def column(value):
+            return np.broadcast_to(
+                np.asarray(value, dtype=float), num_controllers
+            ).copy()
+
+        return PIDBank(
+            kp=column(kp),
+            ki=column(ki),
+            kd=column(kd),
+            setpoint=column(setpoint),
+            last_measurement=column(0.0),
+            integral=column(0.0),
+            output_min=column(output_min),
+            output_max=column(output_max),
+        )
+
+    @staticmethod
+    def from_controllers(
+        controllers: List[PrincipalIntegralDerviativeController],
+    ) -> "PIDBank":
+        return PIDBank(
+            **{
+                f.name: np.array(
+                    [getattr(c, f.name) for c in controllers],
+                    dtype=float,
+                )
+                for f in fields(PIDBank)
+            },
+        )
+
+    def __len__(self) -> int:
+        return len(self.setpoint)
+
+    def controller(self, i: int) -> PrincipalIntegralDerviativeController:
+        """A copy of the state of the i-th controller."""
+        return PrincipalIntegralDerviativeController(
+            **{f.name: float(getattr(self, f.name)[i]) for f in fields(self)},
+        )
+
+    def run(self, measurements: np.ndarray, dt: Union[float, np.ndarray]) -> np.ndarray:
+        error = self.setpoint - measurements
+        self.integral += self.ki * error * dt
+        np.maximum(
+            self.output_min,
+            np.minimum(self.integral, self.output_max),
+            out=self.integral,
+        )
+        derivative = (measurements - self.last_measurement) / dt
+        output = self.kp * error + self.integral + self.kd * derivative
+        self.last_measurement[:] = measurements
+        return np.maximum(self.output_min, np.minimum(output, self.output_max))
+
+
+@dataclass(slots=True)
+class FixedRatePIDController:
+    """A PID controller that is run at a constant interval dt.
+
+    Folding dt into the gains ahead of time leaves one multiplication per term
+    and no division in each step. Results equal those of
+    PrincipalIntegralDerviativeController.run with the same dt, up to floating
+    point rounding. To change the gains or dt, call set_gains.
+    """
+
+    kp: float
+    ki: float
+    kd: float
+    setpoint: float
+    dt: float
+    last_measurement: float = 0.0
+    integral: float = 0.0
+    output_min: float = -1.0
+    output_max: float = 1.0
+    ki_dt: float = field(init=False)
+    kd_over_dt: float = field(init=False)
+
+    def __post_init__(self) -> None:
+        self.set_gains(self.kp, self.ki, self.kd, self.dt)
+
+    def set_gains(self, kp: float, ki: float, kd: float, dt: float) -> None:
+        self.kp, self.ki, self.kd, self.dt = kp, ki, kd, dt
+        self.ki_dt = ki * dt
+        self.kd_over_dt = kd / dt
+
+    def run(self, measurement: float) -> float:
+        error = self.setpoint - measurement
+        output_min, output_max = self.output_min, self.output_max
+        integral = self.integral + self.ki_dt * error
+        integral = output_min if integral < output_min else integral
+        integral = output_max if integral > output_max else integral
+        output = (
+            self.kp * error
+            + integral
+            + self.kd_over_dt * (measurement - self.last_measurement)
+        )
+        self.integral = integral
+        self.last_measurement = measurement
+        output = output_min if output < output_min else output
+        return output_max if output > output_max else output
+
+
+FRACTIONAL_BITS = 16
+INT32_MIN = -(2**31)
+INT32_MAX = 2**31 - 1
+
+
+def to_fixed(x: float, fractional_bits: int = FRACTIONAL_BITS) -> int:
+    """Convert to a signed fixed-point number, saturating at the int32 range."""
+    return saturate(round(x * (1 << fractional_bits)))
+
+
+def from_fixed(x: int, fractional_bits: int = FRACTIONAL_BITS) -> float:
+    return x / (1 << fractional_bits)
+
+
+def saturate(x: int) -> int:
+    return INT32_MIN if x < INT32_MIN else INT32_MAX if x > INT32_MAX else x
+
+
+@dataclass(slots=True)
+class FixedPointPIDController:
+    """A fixed-rate PID controller using only integer arithmetic.
+
+    All values are signed 32-bit fixed-point numbers with FRACTIONAL_BITS
+    fractional bits (Q15.16 by default), as on a microcontroller without a
+    floating point unit. Every intermediate result saturates at the int32
+    range instead of overflowing, and products are rounded toward negative
+    infinity by the arithmetic shift. Use to_fixed and from_fixed to convert
+    parameters and measurements.
+    """
+
+    kp: int
+    ki_dt: int
+    kd_over_dt: int
+    setpoint: int
+    last_measurement: int = 0
+    integral: int = 0
+    output_min: int = -(1 << FRACTIONAL_BITS)
+    output_max: int = 1 << FRACTIONAL_BITS
+    fractional_bits: int = FRACTIONAL_BITS
+
+    @staticmethod
+    def from_float(
+        kp: float,
+        ki: float,
+        kd: float,
+        setpoint: float,
+        dt: float,
+        output_min: float = -1.0,
+        output_max: float = 1.0,
+        fractional_bits: int = FRACTIONAL_BITS,
+    ) -> "FixedPointPIDController":
+        def fixed(x):
+            return to_fixed(x, fractional_bits)
+
+        return FixedPointPIDController(
+            kp=fixed(kp),
+            ki_dt=fixed(ki * dt),
+            kd_over_dt=fixed(kd / dt),
+            setpoint=fixed(setpoint),
+            output_min=fixed(output_min),
+            output_max=fixed(output_max),
+            fractional_bits=fractional_bits,
+        )
+
+    def run(self, measurement: int) -> int:
+        shift = self.fractional_bits
+        output_min, output_max = self.output_min, self.output_max
+        error = saturate(self.setpoint - measurement)
+        # Every sum saturates, as in the int32 code this models, even where
+        # the result is clamped to the output range right after.
+        integral = saturate(self.integral + saturate((self.ki_dt * error) >> shift))
+        integral = output_min if integral < output_min else integral
+        integral = output_max if integral > output_max else integral
+        change = saturate(measurement - self.last_measurement)
+        proportional = saturate((self.kp * error) >> shift)
+        derivative = saturate((self.kd_over_dt * change) >> shift)
+        output = saturate(saturate(proportional + integral) + derivative)
+        self.integral = integral
+        self.last_measurement = measurement
+        output = output_min if output < output_min else output
+        return output_max if output > output_max else output
+
+
 if __name__ == "__main__":  # pragma: no cover
     # Plot the PID control in a simulated environment
     from dataclasses import dataclass, replace
@@ -0,0 +1,285 @@
+"""Tune the gains of a PID controller by simulating it against a plant model.
+
+Each candidate (kp, ki, kd) is run as one controller of a PIDBank, so a whole
+batch of candidates is simulated with one vectorized step per time step, and
+scored by the rise time, overshoot and integrated absolute error (IAE) of its
+response to a step change of the setpoint. Candidates come from a grid, or
+from GP-UCB (tips/gp_ucb.py) over the same grid.
+"""
+
+import itertools
+from concurrent.futures import ProcessPoolExecutor
+from dataclasses import dataclass
+from typing import List, Optional, Protocol, Sequence, Tuple
+
+import numpy as np
+
+from tips.gp_ucb import GpUcb
+from tips.pid import PIDBank
+
+
+class Plant(Protocol):
+    """A system under control, simulated for many controllers at once."""
+
+    def reset(self, num_simulations: int) -> np.ndarray:
+        """Start num_simulations copies of the system, returning measurements."""
+        ...
+
+    def step(self, controls: np.ndarray) -> np.ndarray:
+        """Apply one control to each copy, returning the next measurements."""
+        ...
+
+
+@dataclass
+class LinearPlant:
+    """The measurement changes by control / scale in each step."""
+
+    scale: float = 20.0
+    initial: float = 0.0
+
+    def reset(self, num_simulations: int) -> np.ndarray:
+        self.values = np.full(num_simulations, self.initial)
+        return self.values
+
+    def step(self, controls: np.ndarray) -> np.ndarray:
+        self.values = self.values + controls / self.scale
+        return self.values
+
+
+@dataclass
+class FirstOrderPlant:
+    """The measurement decays toward gain * control with a time constant."""
+
+    gain: float = 1.0
+    time_constant: float = 1.0
+    dt: float = 0.1
+    initial: float = 0.0
+
+    def reset(self, num_simulations: int) -> np.ndarray:
+        self.values = np.full(num_simulations, self.initial)
+        return self.values
+
+    def step(self, controls: np.ndarray) -> np.ndarray:
+        decay = self.dt / self.time_constant
+        self.values = self.values + decay * (self.gain * controls - self.values)
+        return self.values
+
+
+@dataclass
+class Simulation:
+    """The setup of a closed-loop step response: the controllers start with
+    zero integral and last measurement, and the setpoint is held fixed."""
+
+    setpoint: float
+    dt: float
+    num_steps: int
+    output_min: float = -100.0
+    output_max: float = 100.0
+
+
+@dataclass
+class Scores:
+    """Per-candidate metrics of a step response, and a combined cost."""
+
+    rise_time: np.ndarray
+    overshoot: np.ndarray
+    iae: np.ndarray
+    cost: np.ndarray
+
+
+@dataclass
+class Objective:
+    """The cost of a candidate is iae + the weighted overshoot and rise time.
+
+    Overshoot is a fraction of the size of the setpoint step, and a candidate
+    that never reaches 90% of the step has an infinite rise time.
+    """
+
+    overshoot_weight: float = 10.0
+    rise_time_weight: float = 0.0
+
+    def cost(self, rise_time, overshoot, iae) -> np.ndarray:
+        cost = iae + self.overshoot_weight * overshoot
+        if self.rise_time_weight:
+            cost = cost + self.rise_time_weight * rise_time
+        return np.where(np.isfinite(cost), cost, np.inf)
+
+
+def simulate(gains: np.ndarray, plant: Plant, simulation: Simulation) -> np.ndarray:
+    """Simulate each row (kp, ki, kd) of gains as one controller.
+
+    Returns the measurements of shape (num_steps + 1, candidates), where row 0
+    holds the initial measurements.
+    """
+    gains = np.atleast_2d(gains)
+    bank = PIDBank.create(
+        len(gains),
+        kp=gains[:, 0],
+        ki=gains[:, 1],
+        kd=gains[:, 2],
+        setpoint=simulation.setpoint,
+        output_min=simulation.output_min,
+        output_max=simulation.output_max,
+    )
+    measurements = np.empty((simulation.num_steps + 1, len(gains)))
+    measurements[0] = plant.reset(len(gains))
+    for t in range(simulation.num_steps):
+        controls = bank.run(measurements[t], simulation.dt)
+        measurements[t + 1] = plant.step(controls)
+    return measurements
+
+
+def score(
+    measurements: np.ndarray,
+    simulation: Simulation,
+    objective: Objective = Objective(),
+) -> Scores:
+    """Score step responses of shape (steps + 1, candidates)."""
+    initial = measurements[0]
+    step = simulation.setpoint - initial
+    progress = (measurements - initial) / np.where(step == 0, 1, step)
+
+    def first_reaching(level):
+        reached = progress >= level
+        return np.where(reached.any(axis=0), reached.argmax(axis=0), -1)
+
+    start, end = first_reaching(0.1), first_reaching(0.9)
+    rise_time = np.where(end >= 0, (end - start) * simulation.dt, np.inf)
+    overshoot = np.maximum(progress.max(axis=0) - 1, 0)
+    iae = np.abs(simulation.setpoint - measurements[1:]).sum(axis=0) * simulation.dt
+    return Scores(
+        rise_time=rise_time,
+        overshoot=overshoot,
+        iae=iae,
+        cost=objective.cost(rise_time, overshoot, iae),
+    )
+
+
+def evaluate(
+    gains: np.ndarray,
+    plant: Plant,
+    simulation: Simulation,
+    objective: Objective = Objective(),
+) -> Scores:
+    return score(simulate(gains, plant, simulation), simulation, objective)
+
+
+@dataclass
+class TuningResult:
+    gains: Tuple[float, float, float]
+    scores: Scores
+    candidates: np.ndarray
+    costs: np.ndarray
+
+
+def grid_search(
+    plant: Plant,
+    simulation: Simulation,
+    kp_values: Sequence[float],
+    ki_values: Sequence[float],
+    kd_values: Sequence[float],
+    objective: Objective = Objective(),
+    chunk_size: int = 4096,
+    processes: Optional[int] = 1,
+) -> TuningResult:
+    """Evaluate every combination of gains and return the cheapest.
+
+    Candidates are simulated together in chunks of chunk_size. With processes
+    other than 1, chunks are simulated in parallel processes, which requires
+    the plant to be picklable.
+    """
+    candidates = np.array(list(itertools.product(kp_values, ki_values, kd_values)))
+    chunks = [
+        candidates[start : start + chunk_size]
+        for start in range(0, len(candidates), chunk_size)
+    ]
+    args = [(chunk, plant, simulation, objective) for chunk in chunks]
+    if processes == 1:
+        scores = [evaluate(*arg) for arg in args]
+    else:
+        with ProcessPoolExecutor(max_workers=processes) as executor:
+            scores = list(executor.map(evaluate, *zip(*args)))
+    costs = np.concatenate([s.cost for s in scores])
+    best = int(np.argmin(costs))
+    return TuningResult(
+        gains=tuple(candidates[best].tolist()),
+        scores=evaluate(candidates[best], plant, simulation, objective),
+        candidates=candidates,
+        costs=costs,
+    )
+
+
+def gp_ucb_search(
+    plant: Plant,
+    simulation: Simulation,
+    kp_values: Sequence[float],
+    ki_values: Sequence[float],
+    kd_values: Sequence[float],
+    objective: Objective = Objective(),
+    iterations: int = 30,
+    beta: float = 10,
+    trials_per_round: int = 1,
+) -> TuningResult:
+    """Search the grid of gains with GP-UCB, simulating `iterations` candidates.
+
+    Candidates are suggested and simulated trials_per_round at a time, as one
+    vectorized simulation, using GpUcb.suggest_batch. GP-UCB maximizes, so it
+    is given the negated log cost, which keeps the huge costs of unstable
+    candidates from dominating the fit.
+    """
+    optimizer = GpUcb(input_spaces=[kp_values, ki_values, kd_values], beta=beta)
+    candidates: List[np.ndarray] = []
+    costs: List[float] = []
+    while len(candidates) < iterations:
+        k = min(trials_per_round, iterations - len(candidates))
+        trials = optimizer.suggest_batch(k)
+        batch = np.array([point for (_, point) in trials], dtype=float)
+        batch_costs = evaluate(batch, plant, simulation, objective).cost
+        for (trial, _), candidate, cost in zip(trials, batch, batch_costs):
+            candidates.append(candidate)
+            costs.append(float(cost))
+            optimizer.complete(trial, -np.log1p(min(cost, 1e12)))
+    best = int(np.argmin(costs))
+    return TuningResult(
+        gains=tuple(candidates[best].tolist()),
+        scores=evaluate(candidates[best], plant, simulation, objective),
+        candidates=np.array(candidates),
+        costs=np.array(costs),
+    )
+
+
+if __name__ == "__main__":  # pragma: no cover
+    import time
+
+    plant = LinearPlant()
+    simulation = Simulation(setpoint=10, dt=0.1, num_steps=200)
+    values = np.linspace(0, 5, 20).tolist()
+
+    start = time.perf_counter()
+    result = grid_search(plant, simulation, values, values, values)
+    elapsed = time.perf_counter() - start
+    print(
+        f"grid search over {len(result.candidates)} candidates in {elapsed:.2f}s: "
+        f"gains={result.gains}, iae={result.scores.iae[0]:.3f}, "
+        f"overshoot={result.scores.overshoot[0]:.3f}, "
+        f"rise time={result.scores.rise_time[0]:.1f}",
+    )
+
+    for trials_per_round in [1, 10]:
+        start = time.perf_counter()
+        result = gp_ucb_search(
+            plant,
+            simulation,
+            values,
+            values,
+            values,
+            trials_per_round=trials_per_round,
+        )
+        elapsed = time.perf_counter() - start
+        print(
+            f"GP-UCB over {len(result.candidates)} candidates, "
+            f"{trials_per_round} per round, in {elapsed:.2f}s: "
+            f"gains={result.gains}, iae={result.scores.iae[0]:.3f}, "
+            f"overshoot={result.scores.overshoot[0]:.3f}, "
+            f"rise time={result.scores.rise_time[0]:.1f}",
+        )
@@ -0,0 +1,108 @@
+import numpy as np
+import pytest
+
+from tips.pid import PrincipalIntegralDerviativeController as PID
+from tips.pid_autotune import (
+    FirstOrderPlant,
+    LinearPlant,
+    Objective,
+    Simulation,
+    gp_ucb_search,
+    grid_search,
+    score,
+    simulate,
+)
+
+SIMULATION = Simulation(setpoint=10, dt=0.1, num_steps=100)
+
+
+def test_simulate_matches_scalar_controller():
+    gains = np.array([[5.0, 0.5, 0.5], [1.0, 1.0, 0.5], [0.3, 0.0, 0.5]])
+    measurements = simulate(gains, LinearPlant(), SIMULATION)
+
+    for i, (kp, ki, kd) in enumerate(gains):
+        pid = PID(kp=kp, ki=ki, kd=kd, setpoint=10, output_min=-100, output_max=100)
+        value = 0.0
+        expected = [value]
+        for _ in range(SIMULATION.num_steps):
+            value += pid.run(value, dt=0.1) / 20
+            expected.append(value)
+        assert measurements[:, i].tolist() == expected
+
+
+def test_score():
+    simulation = Simulation(setpoint=10, dt=0.5, num_steps=5)
+    # Columns: a response with overshoot, and one that never gets there.
+    measurements = np.array(
+        [
+            [0, 0],
+            [2, 1],
+            [8, 2],
+            [12, 3],
+            [10, 4],
+            [10, 5],
+        ],
+        dtype=float,
+    )
+    scores = score(measurements, simulation, Objective(overshoot_weight=1))
+
+    assert scores.rise_time.tolist() == [1.0, np.inf]
+    np.testing.assert_allclose(scores.overshoot, [0.2, 0])
+    np.testing.assert_allclose(
+        scores.iae, [(8 + 2 + 2) * 0.5, (9 + 8 + 7 + 6 + 5) * 0.5]
+    )
+    np.testing.assert_allclose(scores.cost, scores.iae + scores.overshoot)
+
+
+@pytest.mark.parametrize("plant", [LinearPlant(), FirstOrderPlant(gain=20)])
+def test_grid_search_finds_cheapest_candidate(plant):
+    values = np.linspace(0, 5, 6).tolist()
+    result = grid_search(plant, SIMULATION, values, values, values, chunk_size=50)
+
+    assert len(result.candidates) == 216
+    assert result.gains == tuple(result.candidates[np.argmin(result.costs)])
+    assert result.scores.cost[0] == pytest.approx(result.costs.min())
+    assert abs(simulate(np.array(result.gains), plant, SIMULATION)[-1, 0] - 10) < 0.1
+
+
+def test_grid_search_in_parallel_matches_serial():
+    values = np.linspace(0, 5, 5).tolist()
+    serial = grid_search(LinearPlant(), SIMULATION, values, values, values)
+    parallel = grid_search(
+        LinearPlant(),
+        SIMULATION,
+        values,
+        values,
+        values,
+        chunk_size=30,
+        processes=2,
+    )
+    np.testing.assert_array_equal(serial.costs, parallel.costs)
+    assert serial.gains == parallel.gains
+
+
+def test_gp_ucb_search_finds_a_good_candidate():
+    values = np.linspace(0, 5, 6).tolist()
+    grid = grid_search(LinearPlant(), SIMULATION, values, values, values)
+    result = gp_ucb_search(
+        LinearPlant(),
+        SIMULATION,
+        values,
+        values,
+        values,
+        iterations=20,
+    )
+    assert len(result.candidates) == 20
+    assert result.scores.cost[0] <= np.median(grid.costs)
+
+    batched = gp_ucb_search(
+        LinearPlant(),
+        SIMULATION,
+        values,
+        values,
+        values,
+        iterations=20,
+        trials_per_round=6,
+    )
+    assert len(batched.candidates) == 20
+    assert batched.scores.cost[0] <= np.median(grid.costs)
@@ -0,0 +1,109 @@
+"""Measure the per-step latency and jitter of the PID controller variants.
+
+Run with `python -m tips.pid_benchmark`. Each controller tracks a setpoint of
+a simulated linear system for many steps, and every step is timed
+individually, since for a tight control loop the tail of the latency
+distribution matters as much as the mean.
+"""
+
+import time
+from typing import Callable, Dict, TypeVar
+
+import numpy as np
+
+from tips.pid import (
+    FixedPointPIDController,
+    FixedRatePIDController,
+    PrincipalIntegralDerviativeController,
+    from_fixed,
+)
+
+T = TypeVar("T")
+
+PERCENTILES = [50, 90, 99, 99.9]
+
+
+def step_latencies(
+    step: Callable[[T], T],
+    plant: Callable[[T, T], T],
+    initial: T,
+    num_steps: int,
+) -> np.ndarray:
+    """Run a closed control loop, returning the latency of each step in ns.
+
+    step maps a measurement to a control, and plant maps the current
+    measurement and control to the next measurement. Only step is timed.
+    """
+    clock = time.perf_counter_ns
+    latencies = np.empty(num_steps, dtype=np.int64)
+    measurement = initial
+    for i in range(num_steps):
+        start = clock()
+        control = step(measurement)
+        latencies[i] = clock() - start
+        measurement = plant(measurement, control)
+    return latencies
+
+
+def summarize(latencies: np.ndarray) -> Dict[str, float]:
+    """The mean and percentiles of step latencies, and jitter as p99 - p50."""
+    summary = {"mean": float(latencies.mean())}
+    values = np.percentile(latencies, PERCENTILES)
+    summary.update({f"p{p:g}": float(v) for (p, v) in zip(PERCENTILES, values)})
+    summary["max"] = float(latencies.max())
+    summary["jitter"] = summary["p99"] - summary["p50"]
+    return summary
+
+
+if __name__ == "__main__":  # pragma: no cover
+    num_steps = 200_000
+    dt = 1e-4  # 10 kHz
+    gains = dict(kp=5.0, ki=0.5, kd=0.001, setpoint=10.0)
+    clamps = dict(output_min=-100.0, output_max=100.0)
+
+    def linear_plant(value, control):
+        return value + control / 20
+
+    def fixed_linear_plant(value, control):
+        return value + control // 20
+
+    scalar = PrincipalIntegralDerviativeController(**gains, **clamps)
+    fixed_rate = FixedRatePIDController(**gains, dt=dt, **clamps)
+    fixed_point = FixedPointPIDController.from_float(
+        kp=5.0,
+        ki=0.5,
+        kd=0.001,
+        setpoint=10.0,
+        dt=dt,
+        output_min=-100.0,
+        output_max=100.0,
+    )
+
+    runs = [
+        (
+            "PrincipalIntegralDerviativeController",
+            step_latencies(
+                lambda m: scalar.run(m, dt),
+                linear_plant,
+                0.0,
+                num_steps,
+            ),
+            scalar.last_measurement,
+        ),
+        (
+            "FixedRatePIDController",
+            step_latencies(fixed_rate.run, linear_plant, 0.0, num_steps),
+            fixed_rate.last_measurement,
+        ),
+        (
+            "FixedPointPIDController",
+            step_latencies(fixed_point.run, fixed_linear_plant, 0, num_steps),
+            from_fixed(fixed_point.last_measurement),
+        ),
+    ]
+
+    print(f"{num_steps} steps, latencies in ns")
+    for name, latencies, final in runs:
+        summary = summarize(latencies)
+        stats = ", ".join(f"{key}={value:.0f}" for (key, value) in summary.items())
+        print(f"{name}: {stats}, final measurement={final:.3f}")
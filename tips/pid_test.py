@@ -1,9 +1,17 @@
 from dataclasses import dataclass, replace
 
-from hypothesis import given
-from hypothesis.strategies import floats
-
+import numpy as np
+import pytest
+from hypothesis import given, settings
+from hypothesis.strategies import floats, integers
+
+from tips.pid import (
+    FixedPointPIDController,
+    FixedRatePIDController,
+    PIDBank,
+)
 from tips.pid import PrincipalIntegralDerviativeController as PID
+from tips.pid import from_fixed, to_fixed
 
 
 # A symmetric linear system: the control is directly proportional to the system
@@ -103,3 +111,116 @@ def test_no_lag_after_setpoint_change_from_integral_windup():
         print(f"{control:G}, {system.value:G}, {pid.integral}")
 
     assert control < 0
+
+
+def random_controllers(rng, num_controllers):
+    return [
+        PID(
+            kp=rng.uniform(0, 5),
+            ki=rng.uniform(0, 3),
+            kd=rng.uniform(0, 3),
+            setpoint=rng.uniform(-50, 50),
+            output_min=-rng.uniform(1, 100),
+            output_max=rng.uniform(1, 100),
+        )
+        for _ in range(num_controllers)
+    ]
+
+
+@settings(deadline=None, max_examples=20)
+@given(integers(min_value=0, max_value=10000))
+def test_pid_bank_matches_scalar_controllers(seed):
+    rng = np.random.default_rng(seed)
+    controllers = random_controllers(rng, 50)
+    bank = PIDBank.from_controllers(controllers)
+    dts = rng.uniform(0.01, 1, len(controllers))
+
+    for step in range(100):
+        if step == 50:
+            # Change gains and setpoints mid-run.
+            for i, pid in enumerate(controllers[::3]):
+                pid.ki, pid.setpoint = pid.ki / 2, pid.setpoint + 10
+                bank.ki[3 * i], bank.setpoint[3 * i] = pid.ki, pid.setpoint
+        measurements = rng.uniform(-60, 60, len(controllers))
+        expected = [
+            pid.run(measurement, dt)
+            for (pid, measurement, dt) in zip(controllers, measurements, dts)
+        ]
+        assert bank.run(measurements, dts).tolist() == expected
+
+    for i, pid in enumerate(controllers):
+        assert bank.controller(i) == pid
+
+
+def test_pid_bank_create():
+    bank = PIDBank.create(3, kp=1, ki=0.5, kd=[0, 1, 2], setpoint=10)
+    assert len(bank) == 3
+    assert bank.controller(2) == PID(kp=1, ki=0.5, kd=2, setpoint=10)
+
+
+def test_fixed_rate_controller_matches_pid():
+    pid = PID(kp=2, ki=0.7, kd=0.3, setpoint=10, output_min=-20, output_max=20)
+    fixed_rate = FixedRatePIDController(
+        kp=2,
+        ki=0.7,
+        kd=0.3,
+        setpoint=10,
+        dt=0.1,
+        output_min=-20,
+        output_max=20,
+    )
+    system = SimpleLinearSystem(value=0.0)
+    for step in range(100):
+        if step == 50:
+            pid.ki = 0.2
+            fixed_rate.set_gains(kp=2, ki=0.2, kd=0.3, dt=0.1)
+        control = pid.run(system.value, dt=0.1)
+        assert fixed_rate.run(system.value) == pytest.approx(control, abs=1e-9)
+        system = system.run(control)
+
+
+def test_fixed_point_controller_tracks_float_controller():
+    pid = FixedRatePIDController(
+        kp=2,
+        ki=0.7,
+        kd=0.3,
+        setpoint=10,
+        dt=0.1,
+        output_min=-20,
+        output_max=20,
+    )
+    fixed_point = FixedPointPIDController.from_float(
+        kp=2,
+        ki=0.7,
+        kd=0.3,
+        setpoint=10,
+        dt=0.1,
+        output_min=-20,
+        output_max=20,
+    )
+    system = SimpleLinearSystem(value=0.0)
+    for _ in range(100):
+        control = pid.run(system.value)
+        fixed_control = from_fixed(fixed_point.run(to_fixed(system.value)))
+        assert abs(fixed_control - control) < 1e-3
+        system = system.run(control)
+    assert abs(system.value - 10) < 0.1
+
+
+def test_fixed_point_controller_saturates():
+    assert to_fixed(1e9) == 2**31 - 1
+    assert to_fixed(-1e9) == -(2**31)
+
+    fixed_point = FixedPointPIDController.from_float(
+        kp=1000,
+        ki=1000,
+        kd=1000,
+        setpoint=30000,
+        dt=0.001,
+        output_min=-100,
+        output_max=100,
+    )
+    for measurement in [-(2**31), 2**31 - 1, -(2**31), 0]:
+        output = fixed_point.run(measurement)
+        assert to_fixed(-100) <= output <= to_fixed(100)
+        assert to_fixed(-100) <= fixed_point.integral <= to_fixed(100)
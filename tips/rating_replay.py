@@ -0,0 +1,185 @@
+"""Recompute ratings from the full history of matches.
+
+Changing a rating parameter, like the Elo K-factor or the TrueSkill draw
+probability, requires replaying every match ever played. The match history is
+stored as a columnar log: one .npy file per column, which is memory-mapped and
+read one window of matches at a time. Each window is split into batches of
+independent matches, which are applied with the vectorized updaters, so the
+result is the same as replaying the matches one at a time.
+"""
+
+import os
+from concurrent.futures import ProcessPoolExecutor
+from typing import Any, Callable, Dict, Iterator, List, Optional, Tuple, TypeVar
+
+import numpy as np
+
+from tips.skill_ranking import conflict_free_batches, elo_update_batch
+from tips.skill_ranking_teams import RatingTable, replay_matches
+
+MatchLog = Dict[str, np.ndarray]
+T = TypeVar("T")
+
+
+def save_match_log(directory: str, **columns: np.ndarray) -> None:
+    """Store each column of a match log as directory/<name>.npy."""
+    os.makedirs(directory, exist_ok=True)
+    for name, column in columns.items():
+        np.save(os.path.join(directory, f"{name}.npy"), column)
+
+
+def load_match_log(directory: str) -> MatchLog:
+    """Memory-map all the columns of a match log, read-only."""
+    return {
+        filename[: -len(".npy")]: np.load(
+            os.path.join(directory, filename),
+            mmap_mode="r",
+        )
+        for filename in os.listdir(directory)
+        if filename.endswith(".npy")
+    }
+
+
+def windows(
+    num_matches: int,
+    window: int,
+    checkpoint_every: Optional[int],
+) -> Iterator[Tuple[int, int, bool]]:
+    """Yield (start, end, should_checkpoint) for consecutive windows of matches.
+
+    Windows are cut short at multiples of checkpoint_every, so that checkpoints
+    are taken after exactly that many matches.
+    """
+    start = 0
+    while start < num_matches:
+        end = min(start + window, num_matches)
+        should_checkpoint = False
+        if checkpoint_every:
+            next_checkpoint = (start // checkpoint_every + 1) * checkpoint_every
+            if next_checkpoint <= end:
+                end, should_checkpoint = next_checkpoint, True
+        yield start, end, should_checkpoint
+        start = end
+
+
+def replay_team_log(
+    directory: str,
+    num_players: int,
+    draw_probability: Optional[float] = None,
+    initial: Optional[RatingTable] = None,
+    window: int = 1_000_000,
+    checkpoint_every: Optional[int] = None,
+    checkpoint_directory: Optional[str] = None,
+) -> RatingTable:
+    """Replay a log of TrueSkill team matches.
+
+    Ratings start from a copy of `initial`, or from default ratings if it is
+    not given.
+
+    The log has columns team1, team2 (player ids padded with NO_PLAYER) and
+    outcomes, as in replay_matches. If
+    checkpoint_every is set, the ratings after every checkpoint_every matches
+    are saved to checkpoint_directory/ratings_<number of matches>.npy, which
+    can be opened with RatingTable.load.
+    """
+    log = load_match_log(directory)
+    if initial is None:
+        table = RatingTable.with_defaults(num_players)
+    else:
+        table = RatingTable(means=initial.means.copy(), stddevs=initial.stddevs.copy())
+    for start, end, should_checkpoint in windows(
+        len(log["outcomes"]),
+        window,
+        checkpoint_every,
+    ):
+        replay_matches(
+            table,
+            np.asarray(log["team1"][start:end]),
+            np.asarray(log["team2"][start:end]),
+            np.asarray(log["outcomes"][start:end]),
+            draw_probability,
+        )
+        if should_checkpoint and checkpoint_directory:
+            table.save(os.path.join(checkpoint_directory, f"ratings_{end}.npy"))
+    return table
+
+
+def replay_elo_log(
+    directory: str,
+    num_players: int,
+    alpha: float,
+    initial_mean: float = 1500,
+    variance: float = 50**2,
+    window: int = 1_000_000,
+    checkpoint_every: Optional[int] = None,
+    checkpoint_directory: Optional[str] = None,
+) -> np.ndarray:
+    """Replay a log of Elo games, returning the final mean of each player.
+
+    The log has columns player1, player2 and outcomes, as in elo_update. All
+    players start with the same mean and variance. Checkpoints of the means are
+    saved as in replay_team_log.
+    """
+    log = load_match_log(directory)
+    means = np.full(num_players, initial_mean, dtype=float)
+    variances = np.full(num_players, variance, dtype=float)
+    for start, end, should_checkpoint in windows(
+        len(log["outcomes"]),
+        window,
+        checkpoint_every,
+    ):
+        player1 = np.asarray(log["player1"][start:end])
+        player2 = np.asarray(log["player2"][start:end])
+        outcomes = np.asarray(log["outcomes"][start:end])
+        for batch in conflict_free_batches(zip(player1.tolist(), player2.tolist())):
+            elo_update_batch(
+                means,
+                variances,
+                player1[batch],
+                player2[batch],
+                outcomes[batch],
+                alpha,
+            )
+        if should_checkpoint and checkpoint_directory:
+            np.save(os.path.join(checkpoint_directory, f"ratings_{end}.npy"), means)
+    return means
+
+
+def parameter_sweep(
+    replay: Callable[..., T],
+    settings: List[Dict[str, Any]],
+    processes: Optional[int] = None,
+) -> List[T]:
+    """Run replay(**kwargs) for each kwargs in settings in parallel processes.
+
+    For example, parameter_sweep(replay_elo_log, [dict(directory=d,
+    num_players=n, alpha=a) for a in alphas]).
+    """
+    with ProcessPoolExecutor(max_workers=processes) as executor:
+        futures = [executor.submit(replay, **kwargs) for kwargs in settings]
+        return [future.result() for future in futures]
+
+
+if __name__ == "__main__":  # pragma: no cover
+    import tempfile
+    import time
+
+    num_players, num_games = 100_000, 2_000_000
+    rng = np.random.default_rng(1)
+    player1 = rng.integers(0, num_players, size=num_games)
+    player2 = (player1 + rng.integers(1, num_players, size=num_games)) % num_players
+    outcomes = rng.choice([-1, 0, 1], size=num_games)
+
+    with tempfile.TemporaryDirectory() as directory:
+        save_match_log(directory, player1=player1, player2=player2, outcomes=outcomes)
+        alphas = [0.1, 0.2, 0.3, 0.4]
+        start = time.perf_counter()
+        parameter_sweep(
+            replay_elo_log,
+            [
+                dict(directory=directory, num_players=num_players, alpha=alpha)
+                for alpha in alphas
+            ],
+        )
+        elapsed = time.perf_counter() - start
+        print(f"replayed {num_games} games for {len(alphas)} alphas: {elapsed:.1f}s")
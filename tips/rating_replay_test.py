@@ -0,0 +1,164 @@
+import os
+from math import sqrt
+from statistics import NormalDist
+
+import numpy as np
+import pytest
+
+from tips.rating_replay import (
+    load_match_log,
+    parameter_sweep,
+    replay_elo_log,
+    replay_team_log,
+    save_match_log,
+)
+from tips.skill_ranking import EloSkill, elo_update
+from tips.skill_ranking_teams import (
+    ADDITIVE_DYNAMICS_FACTOR,
+    DEFAULT_MEAN,
+    DEFAULT_STD_DEV,
+    NO_PLAYER,
+    SKILL_CLASS_WIDTH,
+    RatingTable,
+    replay_matches,
+)
+
+
+def random_team_log(num_players, num_matches, seed):
+    rng = np.random.default_rng(seed)
+    team1 = np.full((num_matches, 2), NO_PLAYER)
+    team2 = np.full((num_matches, 2), NO_PLAYER)
+    for i in range(num_matches):
+        players = rng.choice(num_players, size=4, replace=False)
+        team1_size = rng.integers(1, 3)
+        team1[i][:team1_size] = players[:team1_size]
+        team2[i] = players[2:]
+    outcomes = rng.choice([-1, 0, 1], size=num_matches)
+    return team1, team2, outcomes
+
+
+def random_elo_log(num_players, num_games, seed):
+    rng = np.random.default_rng(seed)
+    player1 = rng.integers(0, num_players, size=num_games)
+    player2 = (player1 + rng.integers(1, num_players, size=num_games)) % num_players
+    outcomes = rng.choice([-1, 0, 1], size=num_games)
+    return player1, player2, outcomes
+
+
+def test_match_log_round_trip(tmp_path):
+    team1, team2, outcomes = random_team_log(10, 20, seed=1)
+    save_match_log(str(tmp_path), team1=team1, team2=team2, outcomes=outcomes)
+
+    log = load_match_log(str(tmp_path))
+
+    assert sorted(log) == ["outcomes", "team1", "team2"]
+    np.testing.assert_array_equal(log["team1"], team1)
+    np.testing.assert_array_equal(log["team2"], team2)
+    np.testing.assert_array_equal(log["outcomes"], outcomes)
+
+
+def test_replay_team_log_matches_replay_matches(tmp_path):
+    num_players = 40
+    # Few matches per player, as ratings from the default prior diverge over
+    # many (see test_replay_matches_matches_sequential_updates).
+    team1, team2, outcomes = random_team_log(num_players, 20, seed=2)
+    log_directory = str(tmp_path / "log")
+    checkpoint_directory = str(tmp_path / "checkpoints")
+    os.makedirs(checkpoint_directory)
+    save_match_log(log_directory, team1=team1, team2=team2, outcomes=outcomes)
+    initial = RatingTable.with_defaults(num_players)
+
+    table = replay_team_log(
+        log_directory,
+        num_players,
+        draw_probability=0.05,
+        initial=initial,
+        window=7,
+        checkpoint_every=8,
+        checkpoint_directory=checkpoint_directory,
+    )
+
+    assert (initial.means == RatingTable.with_defaults(num_players).means).all()
+    expected = RatingTable.with_defaults(num_players)
+    replay_matches(expected, team1, team2, outcomes, draw_probability=0.05)
+    np.testing.assert_allclose(table.means, expected.means, rtol=1e-12)
+    np.testing.assert_allclose(table.stddevs, expected.stddevs, rtol=1e-12)
+
+    assert sorted(os.listdir(checkpoint_directory)) == [
+        "ratings_16.npy",
+        "ratings_8.npy",
+    ]
+    checkpoint = RatingTable.load(
+        os.path.join(checkpoint_directory, "ratings_16.npy"),
+        mode="r",
+    )
+    partial = RatingTable.with_defaults(num_players)
+    replay_matches(partial, team1[:16], team2[:16], outcomes[:16], 0.05)
+    np.testing.assert_allclose(checkpoint.means, partial.means, rtol=1e-12)
+
+
+def test_replay_team_log_draw_between_equal_players(tmp_path):
+    # In a draw between equally rated players, v = 0 and the means stay put,
+    # while w and so the new standard deviations depend on the draw margin
+    # eps = inverse_cdf((p + 1) / 2) * sqrt(2) * beta. With x = eps / c:
+    # w = 2 x pdf(x) / (cdf(x) - cdf(-x)).
+    draw_probability = 0.05
+    save_match_log(
+        str(tmp_path),
+        team1=np.array([[0]]),
+        team2=np.array([[1]]),
+        outcomes=np.array([0]),
+    )
+
+    table = replay_team_log(str(tmp_path), 2, draw_probability=draw_probability)
+
+    normal = NormalDist()
+    beta_squared = SKILL_CLASS_WIDTH
+    tau_squared = ADDITIVE_DYNAMICS_FACTOR
+    variance = DEFAULT_STD_DEV**2
+    margin = normal.inv_cdf((draw_probability + 1) / 2) * sqrt(2 * beta_squared)
+    c = sqrt(2 * variance + 2 * beta_squared)
+    x = margin / c
+    w = 2 * x * normal.pdf(x) / (normal.cdf(x) - normal.cdf(-x))
+    stddev = sqrt((variance + tau_squared) * (1 - w * (variance + tau_squared) / c**2))
+
+    assert table.means.tolist() == [DEFAULT_MEAN, DEFAULT_MEAN]
+    np.testing.assert_allclose(table.stddevs, [stddev, stddev], rtol=1e-12)
+    # The default draw probability gives a different result.
+    default = replay_team_log(str(tmp_path), 2)
+    assert abs(default.stddevs[0] - stddev) > 1e-4
+
+
+def test_replay_elo_log_matches_sequential_updates(tmp_path):
+    num_players = 30
+    alpha = 0.3
+    player1, player2, outcomes = random_elo_log(num_players, 500, seed=3)
+    save_match_log(str(tmp_path), player1=player1, player2=player2, outcomes=outcomes)
+
+    means = replay_elo_log(str(tmp_path), num_players, alpha, window=64)
+
+    expected = [EloSkill(mean=1500, variance=50**2) for _ in range(num_players)]
+    for p1, p2, outcome in zip(player1, player2, outcomes):
+        expected[p1], expected[p2] = elo_update(
+            expected[p1],
+            expected[p2],
+            outcome,
+            alpha,
+        )
+    assert means.tolist() == [e.mean for e in expected]
+
+
+def test_parameter_sweep_matches_direct_replays(tmp_path):
+    num_players = 30
+    player1, player2, outcomes = random_elo_log(num_players, 200, seed=4)
+    save_match_log(str(tmp_path), player1=player1, player2=player2, outcomes=outcomes)
+    settings = [
+        dict(directory=str(tmp_path), num_players=num_players, alpha=alpha)
+        for alpha in [0.1, 0.3, 0.5]
+    ]
+
+    results = parameter_sweep(replay_elo_log, settings, processes=2)
+
+    assert len(results) == len(settings)
+    for kwargs, means in zip(settings, results):
+        assert means.tolist() == pytest.approx(replay_elo_log(**kwargs).tolist())
@@ -2,7 +2,10 @@
 
 from dataclasses import dataclass
 from math import erf, sqrt
-from typing import Tuple
+from typing import Collection, Dict, Iterable, List, Tuple
+
+import numpy as np
+from scipy.special import erf as batch_erf
 
 
 @dataclass
@@ -60,3 +63,71 @@ def elo_update(
         EloSkill(truncate(e1.mean + p1_score_change), e1.variance),
         EloSkill(truncate(e2.mean - p1_score_change), e2.variance),
     )
+
+
+def conflict_free_batches(matches: Iterable[Collection[int]]) -> List[List[int]]:
+    """Partition a sequence of matches into batches of independent matches.
+
+    Each match is given as the collection of ids of the players in it. The
+    result is a list of batches of match indices, where no player appears in
+    two matches of the same batch. Each match is placed in the batch right
+    after the last batch containing one of its players, so every player's
+    matches stay in their original order, and applying the batches in order
+    gives the same ratings as applying the matches one at a time.
+    """
+    batches: List[List[int]] = []
+    # The index of the latest batch containing each player
+    last_batch: Dict[int, int] = dict()
+    for match_index, players in enumerate(matches):
+        batch = 1 + max((last_batch.get(p, -1) for p in players), default=-1)
+        if batch == len(batches):
+            batches.append([])
+        batches[batch].append(match_index)
+        for p in players:
+            last_batch[p] = batch
+    return batches
+
+
+def elo_update_batch(
+    means: np.ndarray,
+    variances: np.ndarray,
+    player1: np.ndarray,
+    player2: np.ndarray,
+    outcomes: np.ndarray,
+    alpha: float,
+) -> None:
+    """Apply elo_update to many independent games at once.
+
+    The arrays `means` and `variances` hold the EloSkill of each player, indexed
+    by player id, and are updated in place. Game i is between players
+    player1[i] and player2[i] and has outcome outcomes[i]. No player may appear
+    in more than one game.
+    """
+    var1, var2 = variances[player1], variances[player2]
+    if np.any(var1 != var2):
+        raise ValueError("Variances must agree for all games")  # pragma: no cover
+
+    mean1, mean2 = means[player1], means[player2]
+    win_prob = (1.0 + batch_erf((mean1 - mean2) / np.sqrt(var1 + var2) / sqrt(2.0))) / 2
+    deviation_from_expected = (outcomes + 1) / 2 - win_prob
+    # np.round rounds halves to even, just like round()
+    p1_score_change = np.round(alpha * np.sqrt(var1) * deviation_from_expected)
+
+    means[player1] = np.clip(mean1 + p1_score_change, 0, 3000)
+    means[player2] = np.clip(mean2 - p1_score_change, 0, 3000)
+
+
+def replay_elo_games(
+    means: np.ndarray,
+    variances: np.ndarray,
+    games: List[Tuple[int, int, int]],
+    alpha: float,
+) -> None:
+    """Apply a sequence of (player1, player2, outcome) games to the ratings.
+
+    The result is the same as calling elo_update on each game in order, but
+    independent games are updated together in batches.
+    """
+    for batch in conflict_free_batches((p1, p2) for (p1, p2, _) in games):
+        player1, player2, outcomes = np.array([games[i] for i in batch]).T
+        elo_update_batch(means, variances, player1, player2, outcomes, alpha)
@@ -1,9 +1,15 @@
 """A bare-bones implementation of two-team TrueSkill."""
 
 from dataclasses import dataclass
-from math import sqrt
+from functools import lru_cache
+from math import sqrt, tau
 from statistics import NormalDist
-from typing import Dict, NewType
+from typing import Dict, Iterable, Literal, NewType, Optional, Sequence, Tuple
+
+import numpy as np
+from scipy.special import erf
+
+from tips.skill_ranking import conflict_free_batches
 
 STANDARD_NORMAL = NormalDist(0, 1)
 DEFAULT_MEAN = 25
@@ -32,7 +38,10 @@ class Team:
     ratings: Dict[Player, Rating]
 
 
-def compute_draw_margin() -> float:
+def compute_draw_margin(
+    draw_probability: Optional[float] = None,
+    skill_class_width: Optional[float] = None,
+) -> float:
     """The margin to use to consider the game a draw, based on the (pre-set) probability
     of a draw, which is typically set by measuring the draw rates of a large number of
     games. Derived by inverting the formula.
@@ -43,10 +52,22 @@ def compute_draw_margin() -> float:
     or, as written exactly in the paper,
 
     P(draw) = -1 + 2 * normal_cdf(     draw_margin / (sqrt(n1 + n2) * beta) )
+
+    Arguments left as None default to DRAW_PROBABILITY and SKILL_CLASS_WIDTH,
+    as they are at the time of the call. The margin of each configuration is
+    cached.
     """
-    inv_cdf_arg = 0.5 * (DRAW_PROBABILITY + 1)
+    return _draw_margin(
+        DRAW_PROBABILITY if draw_probability is None else draw_probability,
+        SKILL_CLASS_WIDTH if skill_class_width is None else skill_class_width,
+    )
+
+
+@lru_cache
+def _draw_margin(draw_probability: float, skill_class_width: float) -> float:
+    inv_cdf_arg = 0.5 * (draw_probability + 1)
     inv_cdf_output = STANDARD_NORMAL.inv_cdf(inv_cdf_arg)
-    return inv_cdf_output * sqrt(2 * SKILL_CLASS_WIDTH)
+    return inv_cdf_output * sqrt(2 * skill_class_width)
 
 
 def truncated_onesided_gaussian_v(t: float, lower: float) -> float:
@@ -110,19 +131,51 @@ def truncated_twosided_gaussian_w(perf_diff, draw_margin):
     return v_value**2 + (t1 - t2) / normalization
 
 
-def update_one_team(team1: Team, team2: Team, outcome: int) -> Dict[Player, Rating]:
+def update_one_team(
+    team1: Team,
+    team2: Team,
+    outcome: int,
+    draw_probability: Optional[float] = None,
+) -> Dict[Player, Rating]:
     """Return the new ratings for team1."""
     # Each team is treated as if it were a player whose skill is the sum of the
     # skills of individual teammates, and whose variance is the sum of
     # variances of individual teammates. The normalization is adjusted based on
     # the number of players.
-    draw_margin = compute_draw_margin()
     player_count = len(team1.ratings) + len(team2.ratings)
     t1_mean = sum(p.mean for p in team1.ratings.values())
     t2_mean = sum(p.mean for p in team2.ratings.values())
     t1_variance = sum(p.stddev**2 for p in team1.ratings.values())
     t2_variance = sum(p.stddev**2 for p in team2.ratings.values())
+    adjustment = team_adjustment(
+        t1_mean,
+        t1_variance,
+        t2_mean,
+        t2_variance,
+        player_count,
+        outcome,
+        draw_probability,
+    )
+
+    new_ratings: Dict[Player, Rating] = dict()
+    for player, rating in team1.ratings.items():
+        new_mean, new_stddev = adjust_rating(rating.mean, rating.stddev, *adjustment)
+        new_ratings[player] = Rating(mean=new_mean, stddev=new_stddev)
+
+    return new_ratings
 
+
+def team_adjustment(
+    t1_mean: float,
+    t1_variance: float,
+    t2_mean: float,
+    t2_variance: float,
+    player_count: int,
+    outcome: int,
+    draw_probability: Optional[float] = None,
+) -> Tuple[float, float, float, int]:
+    """Return the quantities (c, v, w, mean_adjustment_direction) for team1."""
+    draw_margin = compute_draw_margin(draw_probability)
     c = sqrt(t1_variance + t2_variance + player_count * SKILL_CLASS_WIDTH)
     winning_mean = t1_mean if outcome >= 0 else t2_mean
     losing_mean = t2_mean if outcome >= 0 else t1_mean
@@ -145,29 +198,356 @@ def update_one_team(team1: Team, team2: Team, outcome: int) -> Dict[Player, Rati
         w = truncated_onesided_gaussian_w(perf_diff / c, draw_margin / c)
         mean_adjustment_direction = outcome
 
+    return c, v, w, mean_adjustment_direction
+
+
+def adjust_rating(
+    mean: float,
+    stddev: float,
+    c: float,
+    v: float,
+    w: float,
+    mean_adjustment_direction: int,
+) -> Tuple[float, float]:
+    """Return the new (mean, stddev) of one player on a team."""
     # Here we propagate the rating adjustment data from the team-wide summed
     # skills down to each player. The normalization constant c is scaled up
     # according to the sum of variances and player counts, which impacts both
     # the value of c and the size of the multiplier that attributes team
     # performance back to the individual player.
-    new_ratings: Dict[Player, Rating] = dict()
-    for player, rating in team1.ratings.items():
-        mean, stddev = rating.mean, rating.stddev
-        mean_multiplier = (mean**2 + ADDITIVE_DYNAMICS_FACTOR) / c
-        variance_plus_dynamics = stddev**2 + ADDITIVE_DYNAMICS_FACTOR
-        stddev_multiplier = variance_plus_dynamics / (c**2)
-        new_mean = mean + mean_adjustment_direction * mean_multiplier * v
-        new_stddev = sqrt(variance_plus_dynamics * (1 - w * stddev_multiplier))
-        new_ratings[player] = Rating(mean=new_mean, stddev=new_stddev)
+    mean_multiplier = (mean**2 + ADDITIVE_DYNAMICS_FACTOR) / c
+    variance_plus_dynamics = stddev**2 + ADDITIVE_DYNAMICS_FACTOR
+    stddev_multiplier = variance_plus_dynamics / (c**2)
+    new_mean = mean + mean_adjustment_direction * mean_multiplier * v
+    new_stddev = sqrt(variance_plus_dynamics * (1 - w * stddev_multiplier))
+    return new_mean, new_stddev
+
+
+def update_ratings(
+    team1: Team,
+    team2: Team,
+    outcome: int = 1,
+    draw_probability: Optional[float] = None,
+) -> Dict[Player, Rating]:
+    # Nb: in Python3.9 the bitwise-or operator is overloaded for dictionaries
+    # to perform a union of the key-value pairs. See PEP584.
+    return update_one_team(team1, team2, outcome, draw_probability) | (
+        update_one_team(team2, team1, -outcome, draw_probability)
+    )
 
-    return new_ratings
 
+# Ratings for many players, stored as dense arrays indexed by player id, and
+# updated in batches of independent matches.
 
-def update_ratings(team1: Team, team2: Team, outcome: int = 1) -> Dict[Player, Rating]:
-    # Nb: in Python3.9 the bitwise-or operator is overloaded for dictionaries
-    # to perform a union of the key-value pairs. See PEP584.
-    return update_one_team(team1, team2, outcome) | update_one_team(
-        team2,
-        team1,
-        -outcome,
+# Teams in a batch are rows of player ids, padded with NO_PLAYER so that teams
+# of different sizes fit in one array.
+NO_PLAYER = -1
+
+
+@dataclass
+class RatingTable:
+    """Player ratings as columns of means and standard deviations.
+
+    Player ids index directly into the columns. A table can be saved to disk
+    and memory-mapped back, so that a service can start without reading all
+    ratings into memory, and so that updates are written through to the file.
+    """
+
+    means: np.ndarray
+    stddevs: np.ndarray
+
+    @staticmethod
+    def with_defaults(num_players: int) -> "RatingTable":
+        return RatingTable(
+            means=np.full(num_players, DEFAULT_MEAN, dtype=float),
+            stddevs=np.full(num_players, DEFAULT_STD_DEV, dtype=float),
+        )
+
+    @staticmethod
+    def create(path: str, num_players: int) -> "RatingTable":
+        """Create a memory-mapped table of default ratings at `path`."""
+        columns = np.lib.format.open_memmap(
+            path,
+            mode="w+",
+            dtype=float,
+            shape=(2, num_players),
+        )
+        columns[0] = DEFAULT_MEAN
+        columns[1] = DEFAULT_STD_DEV
+        return RatingTable(means=columns[0], stddevs=columns[1])
+
+    @staticmethod
+    def load(path: str, mode: Literal["r+", "r", "c"] = "r+") -> "RatingTable":
+        """Memory-map a table stored at `path`.
+
+        The mode is as in np.memmap: "r+" writes updates through to the file,
+        "r" is read-only and "c" keeps updates in memory only.
+        """
+        columns = np.load(path, mmap_mode=mode)
+        return RatingTable(means=columns[0], stddevs=columns[1])
+
+    def save(self, path: str) -> None:
+        columns = np.lib.format.open_memmap(
+            path,
+            mode="w+",
+            dtype=float,
+            shape=(2, len(self.means)),
+        )
+        columns[0] = self.means
+        columns[1] = self.stddevs
+        columns.flush()
+
+    def flush(self) -> None:
+        """Write any pending updates of a memory-mapped table to disk."""
+        for column in (self.means, self.stddevs):
+            if isinstance(column, np.memmap):
+                column.flush()
+
+    def __getitem__(self, player: Player) -> Rating:
+        return Rating(mean=self.means[player], stddev=self.stddevs[player])
+
+    def __setitem__(self, player: Player, rating: Rating) -> None:
+        self.means[player] = rating.mean
+        self.stddevs[player] = rating.stddev
+
+    def team(self, players: Iterable[Player]) -> Team:
+        return Team(ratings={p: self[p] for p in players})
+
+    def update_ratings(
+        self,
+        team1: Sequence[Player],
+        team2: Sequence[Player],
+        outcome: int = 1,
+        draw_probability: Optional[float] = None,
+    ) -> None:
+        """Apply one match to the table in place, as update_ratings would.
+
+        This reads and writes the columns directly, rather than building Team
+        and Rating objects for the match.
+        """
+        # item() reads a Python float, avoiding slower numpy scalar arithmetic.
+        mean, stddev = self.means.item, self.stddevs.item
+        player_count = len(team1) + len(team2)
+        t1_mean = sum(mean(p) for p in team1)
+        t2_mean = sum(mean(p) for p in team2)
+        t1_variance = sum(stddev(p) ** 2 for p in team1)
+        t2_variance = sum(stddev(p) ** 2 for p in team2)
+        adjustments = [
+            (
+                team1,
+                team_adjustment(
+                    t1_mean,
+                    t1_variance,
+                    t2_mean,
+                    t2_variance,
+                    player_count,
+                    outcome,
+                    draw_probability,
+                ),
+            ),
+            (
+                team2,
+                team_adjustment(
+                    t2_mean,
+                    t2_variance,
+                    t1_mean,
+                    t1_variance,
+                    player_count,
+                    -outcome,
+                    draw_probability,
+                ),
+            ),
+        ]
+
+        # Each player's new rating depends only on their own old rating and
+        # the team-wide adjustment, so it is safe to write in place.
+        for team, adjustment in adjustments:
+            for p in team:
+                self.means[p], self.stddevs[p] = adjust_rating(
+                    mean(p),
+                    stddev(p),
+                    *adjustment,
+                )
+
+
+def normal_cdf(x: np.ndarray) -> np.ndarray:
+    return (1.0 + erf(x / sqrt(2.0))) / 2.0
+
+
+def normal_pdf(x: np.ndarray) -> np.ndarray:
+    return np.exp(x**2 / -2.0) / sqrt(tau)
+
+
+def batch_onesided_v_w(t: np.ndarray, lower: np.ndarray) -> Tuple[np.ndarray, ...]:
+    """Vectorized truncated_onesided_gaussian_v and truncated_onesided_gaussian_w."""
+    normalization = normal_cdf(t - lower)
+    safe = normalization >= TOLERANCE
+    v = np.where(
+        safe,
+        normal_pdf(t - lower) / np.where(safe, normalization, 1),
+        lower - t,
+    )
+    return v, v * (v + t - lower)
+
+
+def batch_twosided_v_w(t: np.ndarray, margin: np.ndarray) -> Tuple[np.ndarray, ...]:
+    """Vectorized truncated_twosided_gaussian_v and truncated_twosided_gaussian_w,
+    for the interval [-margin, margin]."""
+    normalization = normal_cdf(margin - t) - normal_cdf(-margin - t)
+    safe = normalization >= TOLERANCE
+    v = np.where(
+        safe,
+        (normal_pdf(-margin - t) - normal_pdf(margin - t))
+        / np.where(safe, normalization, 1),
+        -margin - t,
+    )
+
+    abs_t = np.abs(t)
+    normalization = normal_cdf(margin - abs_t) - normal_cdf(-margin - abs_t)
+    safe = normalization >= TOLERANCE
+    t1 = (margin - abs_t) * normal_pdf(margin - abs_t)
+    t2 = (-margin - abs_t) * normal_pdf(-margin - abs_t)
+    w = np.where(safe, v**2 + (t1 - t2) / np.where(safe, normalization, 1), 1)
+    return v, w
+
+
+def batch_team_adjustments(
+    own_mean: np.ndarray,
+    own_variance: np.ndarray,
+    other_mean: np.ndarray,
+    other_variance: np.ndarray,
+    player_count: np.ndarray,
+    outcomes: np.ndarray,
+    draw_margin: float,
+) -> Tuple[np.ndarray, ...]:
+    """The per-match quantities of update_one_team, for arrays of matches.
+
+    Returns arrays (c, v, w, mean_adjustment_direction) from the perspective of
+    the "own" team, with one entry per match.
+    """
+    c = np.sqrt(own_variance + other_variance + player_count * SKILL_CLASS_WIDTH)
+    winning_mean = np.where(outcomes >= 0, own_mean, other_mean)
+    losing_mean = np.where(outcomes >= 0, other_mean, own_mean)
+    perf_diff = (winning_mean - losing_mean) / c
+
+    draw_v, draw_w = batch_twosided_v_w(perf_diff, draw_margin / c)
+    win_v, win_w = batch_onesided_v_w(perf_diff, draw_margin / c)
+    is_draw = outcomes == 0
+    v = np.where(is_draw, draw_v, win_v)
+    w = np.where(is_draw, draw_w, win_w)
+    direction = np.where(is_draw, 1, outcomes)
+    return c, v, w, direction
+
+
+def update_ratings_batch(
+    table: RatingTable,
+    team1: np.ndarray,
+    team2: np.ndarray,
+    outcomes: np.ndarray,
+    draw_probability: Optional[float] = None,
+) -> None:
+    """Apply the outcomes of many independent matches to `table`, in place.
+
+    Arguments:
+      - table: the ratings of all players, indexed by player id
+      - team1, team2: arrays of shape (num_matches, max_team_size), where row
+        i holds the player ids of each team in match i, padded with NO_PLAYER
+      - outcomes: an array of shape (num_matches,) with the outcome of each
+        match from team1's perspective, as in update_ratings
+      - draw_probability: the probability of a draw used to compute the draw
+        margin, as in compute_draw_margin
+
+    The result is the same as calling update_ratings on each match in turn,
+    which requires that no player appears in more than one match.
+    """
+    team1, team2 = np.asarray(team1), np.asarray(team2)
+    outcomes = np.asarray(outcomes)
+    players = np.sort(
+        np.concatenate([team1[team1 != NO_PLAYER], team2[team2 != NO_PLAYER]]),
     )
+    if np.any(players[1:] == players[:-1]):
+        raise ValueError("A player appears more than once in the batch of matches")
+
+    def team_sums(team):
+        present = team != NO_PLAYER
+        means = np.where(present, table.means[team], 0)
+        variances = np.where(present, table.stddevs[team] ** 2, 0)
+        return present, means.sum(axis=1), variances.sum(axis=1)
+
+    present1, t1_mean, t1_variance = team_sums(team1)
+    present2, t2_mean, t2_variance = team_sums(team2)
+    player_count = present1.sum(axis=1) + present2.sum(axis=1)
+    draw_margin = compute_draw_margin(draw_probability)
+
+    updates = [
+        (team1, present1)
+        + batch_team_adjustments(
+            t1_mean,
+            t1_variance,
+            t2_mean,
+            t2_variance,
+            player_count,
+            outcomes,
+            draw_margin,
+        ),
+        (team2, present2)
+        + batch_team_adjustments(
+            t2_mean,
+            t2_variance,
+            t1_mean,
+            t1_variance,
+            player_count,
+            -outcomes,
+            draw_margin,
+        ),
+    ]
+
+    # Compute both teams' new ratings before writing either back, since the
+    # adjustments above depend only on the old ratings.
+    new_ratings = []
+    for team, present, c, v, w, direction in updates:
+        ids = team[present]
+        # Broadcast the per-match values to each (present) player in the match.
+        c, v, w, direction = (
+            np.broadcast_to(x[:, None], team.shape)[present]
+            for x in (c, v, w, direction)
+        )
+        mean, stddev = table.means[ids], table.stddevs[ids]
+        mean_multiplier = (mean**2 + ADDITIVE_DYNAMICS_FACTOR) / c
+        variance_plus_dynamics = stddev**2 + ADDITIVE_DYNAMICS_FACTOR
+        stddev_multiplier = variance_plus_dynamics / (c**2)
+        new_mean = mean + direction * mean_multiplier * v
+        new_stddev = np.sqrt(variance_plus_dynamics * (1 - w * stddev_multiplier))
+        new_ratings.append((ids, new_mean, new_stddev))
+
+    for ids, new_mean, new_stddev in new_ratings:
+        table.means[ids] = new_mean
+        table.stddevs[ids] = new_stddev
+
+
+def replay_matches(
+    table: RatingTable,
+    team1: np.ndarray,
+    team2: np.ndarray,
+    outcomes: np.ndarray,
+    draw_probability: Optional[float] = None,
+) -> None:
+    """Apply a sequence of matches, in order, to the ratings in `table`.
+
+    The arguments are as in update_ratings_batch, except that players may
+    appear in any number of matches. The matches are split into batches of
+    independent matches, preserving the order of each player's matches, so the
+    result is the same as applying the matches one at a time.
+    """
+    team1, team2 = np.asarray(team1), np.asarray(team2)
+    outcomes = np.asarray(outcomes)
+    players = np.concatenate([team1, team2], axis=1)
+    matches = ([p for p in row if p != NO_PLAYER] for row in players.tolist())
+    for batch in conflict_free_batches(matches):
+        update_ratings_batch(
+            table,
+            team1[batch],
+            team2[batch],
+            outcomes[batch],
+            draw_probability,
+        )
@@ -1,4 +1,21 @@
-from tips.skill_ranking_teams import Player, Rating, Team, update_ratings
+import random
+
+import numpy as np
+import pytest
+
+from tips import skill_ranking_teams
+from tips.skill_ranking import conflict_free_batches
+from tips.skill_ranking_teams import (
+    NO_PLAYER,
+    Player,
+    Rating,
+    RatingTable,
+    Team,
+    compute_draw_margin,
+    replay_matches,
+    update_ratings,
+    update_ratings_batch,
+)
 
 p1 = Player(1)
 p2 = Player(2)
@@ -230,3 +247,142 @@ def test_huge_upset_via_draw():
     assert new_p2_rating.mean > p2_rating.mean
     assert new_p3_rating.mean < p3_rating.mean
     assert new_p4_rating.mean < p4_rating.mean
+
+
+def test_batch_update_matches_update_ratings():
+    random.seed(1)
+    num_players = 400
+    table = RatingTable(
+        means=np.array([random.uniform(0, 50) for _ in range(num_players)]),
+        stddevs=np.array([random.uniform(0.05, 8) for _ in range(num_players)]),
+    )
+    original = RatingTable(table.means.copy(), table.stddevs.copy())
+
+    # Disjoint matches with team sizes between 1 and 3, including upsets and
+    # draws between badly mismatched teams.
+    shuffled = list(range(num_players))
+    random.shuffle(shuffled)
+    players = iter(shuffled)
+    max_team_size = 3
+    team1 = np.full((60, max_team_size), NO_PLAYER)
+    team2 = np.full((60, max_team_size), NO_PLAYER)
+    for i in range(60):
+        for team in (team1, team2):
+            for j in range(random.randint(1, max_team_size)):
+                team[i][j] = next(players)
+    outcomes = np.array([random.choice([-1, 0, 1]) for _ in range(60)])
+
+    update_ratings_batch(table, team1, team2, outcomes)
+
+    def as_team(row):
+        return Team(ratings={Player(p): original[p] for p in row if p != NO_PLAYER})
+
+    for row1, row2, outcome in zip(team1, team2, outcomes):
+        expected = update_ratings(as_team(row1), as_team(row2), outcome)
+        for player, rating in expected.items():
+            assert table.means[player] == pytest.approx(rating.mean, rel=1e-12)
+            assert table.stddevs[player] == pytest.approx(rating.stddev, rel=1e-12)
+
+
+def test_draw_probability_reaches_every_update(monkeypatch):
+    table = RatingTable.with_defaults(4)
+    table[p1] = Rating(mean=2, stddev=0.5)
+    table[p2] = Rating(mean=3, stddev=1)
+    team1, team2 = table.team([p1]), table.team([p2, p3])
+    default = update_ratings(team1, team2, 0)
+
+    likely_draws = update_ratings(team1, team2, 0, draw_probability=0.3)
+    assert likely_draws[p1] != default[p1]
+    update_ratings_batch(table, np.array([[1]]), np.array([[2, 3]]), [0], 0.3)
+    for player, rating in likely_draws.items():
+        assert table.means[player] == pytest.approx(rating.mean, rel=1e-12)
+        assert table.stddevs[player] == pytest.approx(rating.stddev, rel=1e-12)
+
+    # The defaults are read when called, not when the module is loaded.
+    monkeypatch.setattr(skill_ranking_teams, "DRAW_PROBABILITY", 0.3)
+    assert compute_draw_margin() == compute_draw_margin(0.3)
+    assert update_ratings(team1, team2, 0) == likely_draws
+
+
+def test_batch_update_rejects_repeated_players():
+    table = RatingTable.with_defaults(4)
+    team1 = np.array([[0], [1]])
+    team2 = np.array([[2], [0]])
+    with pytest.raises(ValueError):
+        update_ratings_batch(table, team1, team2, np.array([1, 1]))
+
+
+def test_replay_matches_matches_sequential_updates():
+    random.seed(2)
+    num_players = 40
+    table = RatingTable.with_defaults(num_players)
+    expected = {Player(p): Rating() for p in range(num_players)}
+
+    # adjust_rating scales each change of a mean by that mean squared, so
+    # from the default mean of 25, ratings grow by orders of magnitude within
+    # a few matches per player, and beyond about 30 matches among 40 players
+    # update_ratings itself fails with a math domain error. 20 matches keep
+    # the sequential reference finite while still spanning several batches.
+    num_matches = 20
+    team1 = np.full((num_matches, 2), NO_PLAYER)
+    team2 = np.full((num_matches, 2), NO_PLAYER)
+    for i in range(num_matches):
+        players = random.sample(range(num_players), 4)
+        team1_size = random.randint(1, 2)
+        team1[i][:team1_size] = players[:team1_size]
+        team2[i][:2] = players[2:]
+    outcomes = np.array([random.choice([-1, 0, 1]) for _ in range(num_matches)])
+
+    players = np.concatenate([team1, team2], axis=1)
+    matches = ([p for p in row if p != NO_PLAYER] for row in players.tolist())
+    assert len(list(conflict_free_batches(matches))) > 1
+
+    replay_matches(table, team1, team2, outcomes)
+
+    for row1, row2, outcome in zip(team1, team2, outcomes):
+        t1 = Team(ratings={Player(p): expected[p] for p in row1 if p != NO_PLAYER})
+        t2 = Team(ratings={Player(p): expected[p] for p in row2 if p != NO_PLAYER})
+        expected |= update_ratings(t1, t2, outcome)
+
+    for player, rating in expected.items():
+        assert np.isfinite(rating.mean)
+        assert table.means[player] == pytest.approx(rating.mean, rel=1e-09)
+        assert table.stddevs[player] == pytest.approx(rating.stddev, rel=1e-09)
+
+
+def test_table_update_ratings_matches_update_ratings():
+    table = RatingTable.with_defaults(5)
+    table[p1] = Rating(mean=2, stddev=0.1)
+    table[p2] = Rating(mean=6, stddev=0.1)
+    table[p3] = Rating(mean=10, stddev=1)
+    table[p4] = Rating(mean=3, stddev=0.5)
+
+    for outcome in [1, 0, -1, -1]:
+        expected = update_ratings(
+            table.team([p1]),
+            table.team([p2, p3, p4]),
+            outcome,
+        )
+        table.update_ratings([p1], [p2, p3, p4], outcome)
+        for player, rating in expected.items():
+            assert table[player] == rating
+
+
+def test_memory_mapped_table_persists_updates(tmp_path):
+    path = str(tmp_path / "ratings.npy")
+    table = RatingTable.create(path, 10)
+    table.update_ratings([p1, p2], [p3, p4], 1)
+    table.flush()
+    del table
+
+    loaded = RatingTable.load(path, mode="r")
+    assert isinstance(loaded.means, np.memmap)
+    assert loaded[p1].mean > loaded[Player(0)].mean
+    assert loaded[p3].mean < loaded[Player(0)].mean
+    assert loaded[Player(0)] == Rating()
+
+    copy_path = str(tmp_path / "copy.npy")
+    loaded.save(copy_path)
+    copied = RatingTable.load(copy_path)
+    np.testing.assert_array_equal(copied.means, loaded.means)
+    np.testing.assert_array_equal(copied.stddevs, loaded.stddevs)
@@ -1,11 +1,19 @@
+import itertools
 import random
 from collections import Counter
 from statistics import NormalDist, mean
 
+import numpy as np
 from hypothesis import assume, given, settings
 from hypothesis.strategies import integers
 
-from tips.skill_ranking import EloSkill, elo_player1_win_prob, elo_update
+from tips.skill_ranking import (
+    EloSkill,
+    conflict_free_batches,
+    elo_player1_win_prob,
+    elo_update,
+    replay_elo_games,
+)
 
 
 @settings(deadline=2000)
@@ -92,3 +100,39 @@ def test_n_player_tournament():
     inaccuracies = [s - elo for (s, elo) in skills_vs_elo]
     assert mean(inaccuracies) < 200
     assert max(inaccuracies) < 500
+
+
+def test_conflict_free_batches():
+    random.seed(1)
+    matches = [random.sample(range(30), 2) for _ in range(500)]
+    batches = conflict_free_batches(matches)
+
+    assert sorted(i for batch in batches for i in batch) == list(range(500))
+    batch_of = {i: b for (b, batch) in enumerate(batches) for i in batch}
+    for batch in batches:
+        players = [p for i in batch for p in matches[i]]
+        assert len(players) == len(set(players))
+    for i, j in itertools.combinations(range(500), 2):
+        if set(matches[i]) & set(matches[j]):
+            assert batch_of[i] < batch_of[j]
+
+
+def test_replay_elo_games_matches_sequential_updates():
+    random.seed(1)
+    num_players = 30
+    alpha = 0.4
+    variance = 50**2
+    games = []
+    for _ in range(3000):
+        i, j = random.sample(range(num_players), 2)
+        games.append((i, j, random.choice([-1, 0, 1])))
+
+    elos = [EloSkill(mean=1500, variance=variance) for _ in range(num_players)]
+    for i, j, outcome in games:
+        elos[i], elos[j] = elo_update(elos[i], elos[j], outcome, alpha)
+
+    means = np.full(num_players, 1500.0)
+    variances = np.full(num_players, float(variance))
+    replay_elo_games(means, variances, games, alpha)
+
+    assert list(means) == [elo.mean for elo in elos]
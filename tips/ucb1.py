@@ -1,5 +1,10 @@
+import heapq
 import math
-from typing import Callable, Generator, List, TypeVar
+import threading
+from dataclasses import dataclass
+from typing import Callable, Dict, Generator, List, Optional, Tuple, TypeVar
+
+import numpy as np
 
 # just for type clarity
 Action = TypeVar("Action")
@@ -64,3 +69,334 @@ def ucb1(actions: List[Action], reward: RewardFn) -> Generator[Action, None, Non
         num_plays[chosen_action_index] += 1
         payoff_sums[chosen_action_index] += reward(chosen_action)
         t = t + 1
+
+
+class UCB1Index:
+    """The state of UCB1 over many actions, stored as arrays.
+
+    select returns the same action as ucb1 would, without computing the bound
+    of every action. Actions played equally often share the exploration term
+    of their bounds, so they are grouped by play count into heaps ordered by
+    mean reward, and only the top of each group can be chosen. The groups are
+    in turn kept in a max-heap keyed by the bound of their top at a future
+    step, the horizon: bounds only grow with the step t, so the keys are
+    upper bounds, and because log(t) grows slowly they stay close to the
+    current bounds. select examines only the groups whose key is at least the
+    best current bound found, and update touches the heaps of the two groups
+    the played action moves between, so steps take O(log K) time in the usual
+    case. When t passes the horizon, the horizon doubles and all group keys
+    are recomputed.
+
+    Choices only differ from ucb1 if different means of equally often played
+    actions round to the same bound, where ucb1 prefers the lowest index.
+    """
+
+    def __init__(self, num_actions: int):
+        self.num_actions = num_actions
+        self.payoff_sums = np.zeros(num_actions)
+        self.num_plays = np.zeros(num_actions, dtype=np.int64)
+        self.t = 0
+        self.horizon = 0
+        # Heaps of (-mean, action) by play count. An entry is stale once the
+        # action has been played again, and is dropped when it reaches the top.
+        self.groups: Dict[int, List[Tuple[float, int]]] = {}
+        # The number of actions in each group, without stale entries.
+        self.sizes: Dict[int, int] = {}
+        # Entries are (-key, play count, version); an entry is stale once the
+        # group's version has moved on. Versions are never reused, even after
+        # a group is dropped and comes back.
+        self.heap: List[Tuple[float, int, int]] = []
+        self.versions: Dict[int, int] = {}
+        self.version = 0
+
+    def upper_confidence_bounds(self) -> np.ndarray:
+        """The current upper confidence bound of every action, vectorized."""
+        with np.errstate(divide="ignore", invalid="ignore"):
+            return self.payoff_sums / self.num_plays + np.sqrt(
+                2 * np.log(self.t) / self.num_plays,
+            )
+
+    def upper_confidence_bound(self, action: int) -> float:
+        """The current bound of one action, computed exactly as ucb1 does."""
+        num_plays = int(self.num_plays[action])
+        return float(self.payoff_sums[action]) / num_plays + math.sqrt(
+            2 * math.log(self.t) / num_plays,
+        )
+
+    def select(self) -> int:
+        if self.t < self.num_actions:
+            # Play each action once to initialize empirical sums.
+            return self.t
+        if self.t > self.horizon:
+            self.horizon = 2 * self.t
+            self.heap = []
+            for num_plays in list(self.groups):
+                self._push_group(num_plays)
+
+        heap = self.heap
+        best, best_bound = -1, -math.inf
+        examined = []
+        while heap and -heap[0][0] >= best_bound:
+            _, num_plays, version = heapq.heappop(heap)
+            if version != self.versions.get(num_plays):
+                continue
+            action = self._top(num_plays)
+            if action is None:
+                self._drop_group(num_plays)
+                continue
+            examined.append(num_plays)
+            bound = self.upper_confidence_bound(action)
+            if bound > best_bound or (bound == best_bound and action < best):
+                best, best_bound = action, bound
+        for num_plays in examined:
+            self._push_group(num_plays)
+        return best
+
+    def update(self, action: int, reward: float) -> None:
+        self.payoff_sums[action] += reward
+        self.num_plays[action] += 1
+        self.t += 1
+        num_plays = int(self.num_plays[action])
+        mean = float(self.payoff_sums[action]) / num_plays
+        heapq.heappush(self.groups.setdefault(num_plays, []), (-mean, action))
+        self.sizes[num_plays] = self.sizes.get(num_plays, 0) + 1
+        old = num_plays - 1
+        if old in self.sizes:
+            self.sizes[old] -= 1
+            group = self.groups[old]
+            if self.sizes[old] == 0:
+                self._drop_group(old)
+            elif len(group) > 2 * self.sizes[old] + 16:
+                # Drop stale entries, so memory stays O(K) however long it runs.
+                group[:] = [e for e in group if self.num_plays[e[1]] == old]
+                heapq.heapify(group)
+        if self.horizon:
+            self._push_group(num_plays)
+
+    def _top(self, num_plays: int) -> Optional[int]:
+        """The action with the highest mean in a group, if any is left."""
+        group = self.groups[num_plays]
+        while group and self.num_plays[group[0][1]] != num_plays:
+            heapq.heappop(group)
+        return group[0][1] if group else None
+
+    def _push_group(self, num_plays: int) -> None:
+        """Replace the key of a group by that of its current top, if any."""
+        self.version += 1
+        self.versions[num_plays] = self.version
+        action = self._top(num_plays)
+        if action is None:
+            self._drop_group(num_plays)
+            return
+        key = -self.groups[num_plays][0][0] + math.sqrt(
+            2 * math.log(self.horizon) / num_plays,
+        )
+        # A small margin guards the keys against rounding.
+        key += 1e-9 * (1 + abs(key))
+        heapq.heappush(self.heap, (-key, num_plays, self.versions[num_plays]))
+
+    def _drop_group(self, num_plays: int) -> None:
+        """Forget an empty group; its entries in the heap become stale."""
+        del self.groups[num_plays]
+        self.sizes.pop(num_plays, None)
+        self.versions.pop(num_plays, None)
+
+
+def ucb1_indexed(
+    actions: List[Action],
+    reward: RewardFn,
+) -> Generator[Action, None, None]:
+    """UCB1 as in ucb1, with O(log K) steps for large numbers of actions K."""
+    index = UCB1Index(len(actions))
+    while True:
+        chosen_action_index = index.select()
+        chosen_action: Action = actions[chosen_action_index]
+        yield chosen_action
+        index.update(chosen_action_index, reward(chosen_action))
+
+
+@dataclass
+class Shard:
+    """Rewards recorded by one thread, summed since the bandit was created."""
+
+    payoff_sums: np.ndarray
+    num_plays: np.ndarray
+
+
+class DelayedUCB1:
+    """UCB1 for serving, where rewards arrive late, out of order, and from
+    many threads.
+
+    select_batch chooses many actions at once, as select would one at a
+    time. record can be called from any thread, at any time: each
+    thread adds to its own Shard, so no locks are taken, and merge, called
+    periodically by the selecting thread, sums the shards into the
+    statistics used for selection. Because shards are only ever written by
+    their own thread and only read by merge, no record is lost.
+
+    With pending_correction, an action that was chosen but whose reward has
+    not been merged yet counts as played, with the mean of its merged
+    rewards. That shrinks its exploration term while results are delayed,
+    so a batch spreads over actions instead of repeating the one with the
+    highest bound.
+    """
+
+    def __init__(self, num_actions: int, pending_correction: bool = True):
+        self.num_actions = num_actions
+        self.pending_correction = pending_correction
+        self.payoff_sums = np.zeros(num_actions)
+        self.num_plays = np.zeros(num_actions, dtype=np.int64)
+        self.issued = np.zeros(num_actions, dtype=np.int64)
+        self.shards: List[Shard] = []
+        self._local = threading.local()
+        self._lock = threading.Lock()
+
+    def upper_confidence_bounds(self) -> np.ndarray:
+        """The bound of each action, infinite for actions never counted."""
+        counts = self._counts()
+        return self._bounds(self._means(), counts, int(counts.sum()))
+
+    @staticmethod
+    def _bounds(means: np.ndarray, counts: np.ndarray, t: int) -> np.ndarray:
+        with np.errstate(divide="ignore", invalid="ignore"):
+            bounds = means + np.sqrt(2 * np.log(max(t, 1)) / counts)
+        return np.where(counts == 0, np.inf, bounds)
+
+    def _means(self) -> np.ndarray:
+        return self.payoff_sums / np.maximum(self.num_plays, 1)
+
+    def _counts(self) -> np.ndarray:
+        if self.pending_correction:
+            return np.maximum(self.issued, self.num_plays)
+        return self.num_plays
+
+    def select_batch(self, n: int) -> np.ndarray:
+        """Choose n actions, as n calls of select without feedback in between.
+
+        With pending_correction, each choice counts the chosen action as
+        played once more, which lowers its bound but raises t, and with it
+        every other bound. t grows by at most n over the batch, so an action
+        can only be chosen if its bound for t + n reaches the n-th highest
+        bound now, the least bound some action not chosen yet keeps for the
+        whole batch. Among candidates with the same count, the one with the
+        highest mean has the highest bound, so each choice only compares the
+        best of each count. Ties go to the lowest index, as in ucb1.
+        """
+        bounds = self.upper_confidence_bounds()
+        if not self.pending_correction:
+            chosen = np.full(n, int(np.argmax(bounds)))
+            self.issued[chosen[0]] += n
+            return chosen
+
+        means, counts = self._means(), self._counts()
+        t = int(counts.sum())
+        if 0 < n < self.num_actions:
+            threshold = -np.partition(-bounds, n - 1)[n - 1]
+            if np.isinf(threshold):
+                # The first n untried actions come first, in order.
+                candidates = np.flatnonzero(counts == 0)[:n]
+            else:
+                highest = self._bounds(means, counts, t + n)
+                candidates = np.flatnonzero(highest >= threshold)
+        else:
+            candidates = np.arange(self.num_actions)
+
+        means, counts = means[candidates], counts[candidates]
+        issued = self.issued[candidates]
+        num_plays = self.num_plays[candidates]
+        # Heaps of (-mean, candidate) by count: only the top of each can have
+        # the highest bound, whatever t is.
+        groups: Dict[int, List[Tuple[float, int]]] = {}
+        for j, (mean, count) in enumerate(zip(means.tolist(), counts.tolist())):
+            groups.setdefault(count, []).append((-mean, j))
+        for group in groups.values():
+            heapq.heapify(group)
+
+        chosen = np.empty(n, dtype=np.int64)
+        for i in range(n):
+            tops = np.array([group[0][1] for group in groups.values()])
+            bounds = self._bounds(means[tops], counts[tops], t)
+            j = int(tops[bounds == bounds.max()].min())
+            chosen[i] = candidates[j]
+            issued[j] += 1
+            old, count = int(counts[j]), max(int(issued[j]), int(num_plays[j]))
+            if count != old:
+                heapq.heappop(groups[old])
+                if not groups[old]:
+                    del groups[old]
+                heapq.heappush(groups.setdefault(count, []), (-means[j], j))
+                t += count - old
+                counts[j] = count
+        np.add.at(self.issued, chosen, 1)
+        return chosen
+
+    def select(self) -> int:
+        return int(self.select_batch(1)[0])
+
+    def record(self, action: int, reward: float) -> None:
+        """Record the reward of an action chosen earlier, from any thread."""
+        shard = getattr(self._local, "shard", None)
+        if shard is None:
+            shard = Shard(
+                payoff_sums=np.zeros(self.num_actions),
+                num_plays=np.zeros(self.num_actions, dtype=np.int64),
+            )
+            self._local.shard = shard
+            with self._lock:
+                self.shards.append(shard)
+        shard.payoff_sums[action] += reward
+        shard.num_plays[action] += 1
+
+    def merge(self) -> None:
+        """Fold the rewards recorded so far into the selection statistics."""
+        with self._lock:
+            shards = list(self.shards)
+        self.payoff_sums = sum(
+            (shard.payoff_sums for shard in shards),
+            np.zeros(self.num_actions),
+        )
+        self.num_plays = sum(
+            (shard.num_plays for shard in shards),
+            np.zeros(self.num_actions, dtype=np.int64),
+        )
+
+
+if __name__ == "__main__":  # pragma: no cover
+    import time
+
+    rng = np.random.default_rng(0)
+    num_actions, num_steps = 100_000, 20_000
+    probabilities = rng.uniform(0, 0.1, num_actions)
+    rewards = rng.random((num_steps,))
+
+    for name in ["vectorized argmax", "indexed"]:
+        index = UCB1Index(num_actions)
+        for action in range(num_actions):
+            index.update(action, float(rng.random() < probabilities[action]))
+        start = time.perf_counter()
+        for step in range(num_steps):
+            if name == "indexed":
+                action = index.select()
+            else:
+                action = int(np.argmax(index.upper_confidence_bounds()))
+            index.update(action, float(rewards[step] < probabilities[action]))
+        elapsed = time.perf_counter() - start
+        print(f"{name}: {1e6 * elapsed / num_steps:.1f}us per step")
+
+    bandit = DelayedUCB1(num_actions)
+    num_batches, batch_size = 50, 1000
+    delayed: List[np.ndarray] = []
+    start = time.perf_counter()
+    for _ in range(num_batches):
+        actions = bandit.select_batch(batch_size)
+        delayed.append(actions)
+        # Rewards arrive five batches late.
+        if len(delayed) > 5:
+            for action in delayed.pop(0).tolist():
+                bandit.record(action, float(rng.random() < probabilities[action]))
+            bandit.merge()
+    elapsed = time.perf_counter() - start
+    print(
+        f"delayed, batches of {batch_size}: "
+        f"{num_batches * batch_size / elapsed:.0f} decisions per second",
+    )
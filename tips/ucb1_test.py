@@ -1,9 +1,14 @@
 import random
+import threading
 from dataclasses import dataclass
 
+import numpy as np
+import pytest
 from assertpy import assert_that
+from hypothesis import given, settings
+from hypothesis.strategies import integers
 
-from tips.ucb1 import ucb1
+from tips.ucb1 import DelayedUCB1, UCB1Index, ucb1, ucb1_indexed
 
 
 def test_find_best_action():
@@ -54,3 +59,132 @@ def test_discriminate_between_two_close_actions():
         next(generator)
 
     assert_that(next(generator)).is_equal_to(best_action)
+
+
+@settings(deadline=None, max_examples=20)
+@given(integers(min_value=0, max_value=10000), integers(min_value=1, max_value=60))
+def test_indexed_matches_ucb1(seed, num_actions):
+    probabilities = random.Random(seed).choices([0.1, 0.3, 0.5, 0.7], k=num_actions)
+    actions = list(range(num_actions))
+
+    def rewards():
+        rng = random.Random(seed)
+        return lambda action: 1 if rng.random() < probabilities[action] else 0
+
+    expected = ucb1(actions, rewards())
+    actual = ucb1_indexed(actions, rewards())
+    for _ in range(2000):
+        assert next(actual) == next(expected)
+
+
+def test_indexed_memory_stays_bounded():
+    rng = random.Random(7)
+    num_actions = 20
+    index = UCB1Index(num_actions)
+    for _ in range(20000):
+        action = index.select()
+        index.update(action, 1 if rng.random() < 0.1 + 0.04 * action else 0)
+
+    assert len(index.sizes) <= num_actions
+    assert len(index.groups) <= num_actions
+    assert len(index.versions) <= num_actions
+    for num_plays, group in index.groups.items():
+        assert len(group) <= 2 * index.sizes[num_plays] + 17
+
+
+def test_vectorized_bounds():
+    index = UCB1Index(5)
+    for action, reward in enumerate([0.5, 1.0, 0.0, 0.25, 0.75] * 3):
+        index.update(action % 5, reward)
+    index.update(2, 1.0)
+    bounds = index.upper_confidence_bounds()
+    for action in range(5):
+        assert bounds[action] == pytest.approx(index.upper_confidence_bound(action))
+    assert index.select() == int(np.argmax(bounds))
+
+
+def test_delayed_ucb1_with_immediate_feedback_finds_best_action():
+    rng = np.random.default_rng(5)
+    probabilities = [0.1, 0.2, 0.3, 0.4]
+    bandit = DelayedUCB1(len(probabilities))
+    for _ in range(5000):
+        action = bandit.select()
+        bandit.record(action, float(rng.random() < probabilities[action]))
+        bandit.merge()
+    assert bandit.select() == 3
+
+
+def test_delayed_ucb1_batch_spreads_over_actions():
+    bandit = DelayedUCB1(100)
+    assert sorted(bandit.select_batch(100).tolist()) == list(range(100))
+
+    uncorrected = DelayedUCB1(100, pending_correction=False)
+    assert len(set(uncorrected.select_batch(10).tolist())) == 1
+
+
+@settings(deadline=None, max_examples=30)
+@given(integers(min_value=0, max_value=10000), integers(min_value=1, max_value=300))
+def test_delayed_ucb1_batch_matches_repeated_select(seed, n):
+    rng = np.random.default_rng(seed)
+    num_actions = int(rng.integers(1, 60))
+    batched = DelayedUCB1(num_actions)
+    # Start cold, or with some rewards merged and others still in flight.
+    for _ in range(int(rng.integers(0, 3))):
+        for action in batched.select_batch(int(rng.integers(1, 100))).tolist():
+            if rng.random() < 0.7:
+                batched.record(action, float(rng.random() < 0.3))
+        batched.merge()
+    repeated = DelayedUCB1(num_actions)
+    for name in ["payoff_sums", "num_plays", "issued"]:
+        setattr(repeated, name, getattr(batched, name).copy())
+
+    actions = batched.select_batch(n)
+
+    assert actions.tolist() == [repeated.select() for _ in range(n)]
+    np.testing.assert_array_equal(batched.issued, repeated.issued)
+
+
+def test_delayed_ucb1_with_late_out_of_order_rewards():
+    rng = np.random.default_rng(6)
+    probabilities = rng.uniform(0, 0.5, 50)
+    probabilities[17] = 0.9
+    bandit = DelayedUCB1(len(probabilities))
+    in_flight = []
+    chosen = []
+    for _ in range(300):
+        actions = bandit.select_batch(20)
+        chosen.append(actions)
+        in_flight.extend(actions.tolist())
+        # Rewards arrive in random order, and only some of them each round.
+        rng.shuffle(in_flight)
+        arrived, in_flight = in_flight[:15], in_flight[15:]
+        for action in arrived:
+            bandit.record(action, float(rng.random() < probabilities[action]))
+        bandit.merge()
+
+    assert np.bincount(np.concatenate(chosen[-50:])).argmax() == 17
+
+
+def test_delayed_ucb1_merges_records_from_threads():
+    bandit = DelayedUCB1(10)
+    actions = bandit.select_batch(4000)
+
+    def record(part):
+        for action in part.tolist():
+            bandit.record(action, 0.5)
+
+    threads = [
+        threading.Thread(target=record, args=(part,))
+        for part in np.array_split(actions, 4)
+    ]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    bandit.merge()
+
+    assert len(bandit.shards) == 4
+    expected = np.bincount(actions, minlength=10)
+    np.testing.assert_array_equal(expected, np.full(10, 400))
+    np.testing.assert_array_equal(bandit.num_plays, expected)
+    np.testing.assert_array_equal(bandit.payoff_sums, 0.5 * expected)